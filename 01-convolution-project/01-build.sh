@@ -5,4 +5,4 @@ set -e
 make clean
 make 
 echo 
-ls -l bin/*.run
+ls -l bin/*.run bin/libconv2d.*
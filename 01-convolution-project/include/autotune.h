@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "conv2d.h"
+
+// A shape is tuned once per (image size, channels, kernel size, kernel
+// type, stride, dtype); the type matters because built-in and symmetric
+// kernels take different engine paths.
+struct TuneKey {
+    int height;
+    int width;
+    int channels;
+    int kernel_size;
+    int kernel_type;
+    int stride;
+    int dtype;
+};
+
+struct TuneConfig {
+    int engine_mode = ENGINE_MODE_BASELINE;
+    int tile_rows   = 0;        // 0 = one band per thread
+    int threads     = 1;
+    double ms       = 0.0;      // median time when tuned
+};
+
+TuneKey tune_key(const Conv2DParams& params);
+
+// Cache file used by autotune_lookup(); TUNE_CACHE_PATH_DEF by default. It
+// is read on first lookup and rewritten whenever a shape is added.
+void autotune_set_cache_path(const std::string& path);
+
+// Benchmarks candidate configurations for params' shape (on scratch data,
+// with params' kernel) and returns the fastest: engines first, then tile
+// sizes for the winning engine, then thread counts. Nothing is cached.
+// report, when set, receives one line per candidate.
+int autotune_shape(const Conv2DParams& params, TuneConfig& best, FILE *report = nullptr);
+
+// Stores config for key in the cache and persists the file.
+int autotune_store(const TuneKey& key, const TuneConfig& config);
+
+// Cached configuration for params' shape; tunes and stores it on a miss.
+// Thread safe; concurrent misses on one shape tune it once.
+int autotune_lookup(const Conv2DParams& params, TuneConfig& config);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct BenchmarkStats {
+    int samples = 0;
+
+    double min    = 0.0;
+    double max    = 0.0;
+    double mean   = 0.0;
+    double median = 0.0;
+    double p95    = 0.0;
+    double p99    = 0.0;
+    double stddev = 0.0;
+    double cv     = 0.0;    // coefficient of variation (stddev / mean)
+};
+
+struct BenchmarkReport {
+    int engine_mode;
+    int kernel_type;
+    int kernel_size;
+    int color_mode;
+    int dtype;
+
+    int threads;            // workers sharing each repetition's batch
+    int warmup;
+    int images;
+
+    double megapixels;      // output pixels per repetition, all channels
+    double gflop;           // multiply-adds * 2 per repetition
+
+    BenchmarkStats stats;   // per repetition, milliseconds
+};
+
+int compute_benchmark_stats(
+    const std::vector<double>& samples_ms,
+    BenchmarkStats& stats
+);
+
+double percentile(
+    const std::vector<double>& sorted,
+    double p
+);
+
+int pin_to_cpu(int cpu);
+
+int parse_report_format(const std::string& name);
+
+int write_benchmark_report(
+    const BenchmarkReport& report,
+    int report_format,
+    const std::string& report_path
+);
@@ -0,0 +1,46 @@
+#pragma once
+
+// Coefficients of the built-in filters. kernel_factory hands them out and the
+// SSE/AVX engines bake them into specialised code, so both must read them from
+// here: an engine variant is only picked when the kernel matches bit for bit.
+
+constexpr float SHARPEN_3X3[9] = {
+     0, -1,  0,
+    -1,  5, -1,
+     0, -1,  0
+};
+
+constexpr float SOBEL_X_3X3[9] = {
+    -1, 0, 1,
+    -2, 0, 2,
+    -1, 0, 1
+};
+
+constexpr float SOBEL_Y_3X3[9] = {
+    -1, -2, -1,
+     0,  0,  0,
+     1,  2,  1
+};
+
+// Normalised 1D Gaussian profiles for the default sigma (size / 3); the 2D
+// kernel is their outer product. Generated with the factory's own formula.
+constexpr float GAUSSIAN_1D_3[3] = {
+    0.274068624f, 0.451862752f, 0.274068624f
+};
+
+constexpr float GAUSSIAN_1D_5[5] = {
+    0.133574709f, 0.22921513f, 0.274420321f, 0.22921513f, 0.133574709f
+};
+
+constexpr float GAUSSIAN_1D_7[7] = {
+    0.0860538781f, 0.136204481f, 0.179408893f, 0.196665481f,
+    0.179408893f, 0.136204481f, 0.0860538781f
+};
+
+// Default-sigma profile for the given size, nullptr when not baked.
+constexpr const float* gaussian_1d_table(int size) {
+    return size == 3 ? GAUSSIAN_1D_3 
+         : size == 5 ? GAUSSIAN_1D_5 
+         : size == 7 ? GAUSSIAN_1D_7 
+         : nullptr;
+}
@@ -1,8 +1,10 @@
 #pragma once 
 
 #include <string> 
+#include <vector>
 
 #include "constants.h"
+#include "pyramid_mode.h"
 
 struct CLIArgs {
 
@@ -11,6 +13,7 @@ struct CLIArgs {
     int engine_mode = ENGINE_MODE_NONE;
 
     int kernel_type = KERNEL_TYPE_NONE;
+    std::string kernel_name;
 
     int kernel_size = 0;
 
@@ -22,11 +25,47 @@ struct CLIArgs {
     std::string fc_bias_path;
 
     int color_mode = COLOR_MODE_NONE;
+    int dtype      = DTYPE_F32;
 
     bool eval = false;
 
     bool help = false;
     bool save_output = false;
+
+    int warmup        = 0;
+    int repetitions   = 1;
+    int cpu           = -1;
+    int report_format = REPORT_FORMAT_TEXT;
+
+    std::string report_path;
+
+    bool perf_counters = false;
+
+    std::string trace_path;
+    std::string tune_cache;
+
+    bool pipeline       = false;
+    int  decode_threads = 1;
+    int  conv_threads   = 1;
+    int  encode_threads = 1;
+    int  queue_depth    = 8;
+
+    std::string socket_path = SERVE_SOCKET_PATH_DEF;
+
+    int requests   = 1000;
+    int clients    = 1;
+    int frame_size = 512;
+
+    bool shm   = false;
+    int  slots = 4;
+
+    int frame_width  = 0;
+    int frame_height = 0;
+
+    int pyramid_type = PYRAMID_TYPE_GAUSSIAN;
+    int levels       = PYRAMID_LEVELS_DEF;
+
+    std::vector<FilterSpec> bank;
 };
 
 void print_help();
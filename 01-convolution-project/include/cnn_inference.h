@@ -1,12 +1,18 @@
 #pragma once 
 
+#include <cstddef>
+#include <cstdint>
+
 #include "conv2d.h"
+#include "constants.h"
 #include "infer_test.h"
 
 struct CNNModel {
     Kernel kernel;
     const float* fc_weight = nullptr;
     const float* fc_bias   = nullptr;
+    int in_height = CNN_INPUT_HEIGHT;
+    int in_width  = CNN_INPUT_WIDTH;
     int in_features = 0;
     int out_features = 2;
 };
@@ -16,6 +22,41 @@ int load_model(
     CNNModel& model
 );
 
+void free_model(CNNModel& model);
+
+// image must match the model input (64x64, one channel)
+int infer_image(
+    int engine_mode,
+    const Image& image,
+    const CNNModel& model,
+    int& predicted_class
+);
+
+// Classifies an 8-bit grey image of any size in one streaming pass: each
+// model-input row is resized (resize_image() mapping), scaled to [0, 1] and
+// pushed into a ring of kernel.size rows; every completed conv row goes
+// straight through ReLU into the FC sums. Nothing image-sized is allocated.
+// stride is in bytes between source rows.
+int infer_gray8(
+    int engine_mode,
+    const uint8_t *pixels,
+    int height,
+    int width,
+    size_t stride,
+    const CNNModel& model,
+    int& predicted_class
+);
+
+// Decodes a JPEG/PNG/... file as grey and runs infer_gray8() on it.
+int infer_image_file(
+    const std::string& image_path,
+    int engine_mode,
+    const CNNModel& model,
+    int& predicted_class
+);
+
+// CNN_TENSOR_EXT files go through load_tensor(); anything else is decoded
+// as a source image.
 int infer_single(
     const std::string& image_path,
     int engine_mode,
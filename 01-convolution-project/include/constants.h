@@ -6,11 +6,23 @@
 #define RUN_MODE_FUNCTIONAL_TEST      1
 #define RUN_MODE_SPEED_TEST           2
 #define RUN_MODE_INFER_TEST           3
+#define RUN_MODE_ROOFLINE             4
+#define RUN_MODE_SERVE                5
+#define RUN_MODE_LOADGEN              6
+#define RUN_MODE_STREAM               7
+#define RUN_MODE_PYRAMID              8
+#define RUN_MODE_TUNE                 9
 #define RUN_MODE_NONE                -1
 
 #define RUN_MODE_FUNCTIONAL_TEST_STR       "Functional Test"
 #define RUN_MODE_SPEED_TEST_STR                 "Speed Test"
 #define RUN_MODE_INFER_TEST_STR             "Inference Test"
+#define RUN_MODE_ROOFLINE_STR            "Roofline Analysis"
+#define RUN_MODE_SERVE_STR                   "Serve"
+#define RUN_MODE_LOADGEN_STR         "Load Generator"
+#define RUN_MODE_STREAM_STR                 "Stream"
+#define RUN_MODE_PYRAMID_STR               "Pyramid"
+#define RUN_MODE_TUNE_STR                     "Tune"
 
 // ========================================================================== 
 // ============================= Engine Mode ================================
@@ -18,11 +30,28 @@
 #define ENGINE_MODE_BASELINE           1
 #define ENGINE_MODE_SSE                2   
 #define ENGINE_MODE_AVX                3
+#define ENGINE_MODE_AUTO               4   // resolved through the tuning cache
 #define ENGINE_MODE_NONE              -1
 
 #define ENGINE_MODE_BASELINE_STR    "Baseline"
 #define ENGINE_MODE_SSE_STR             "SSE"
 #define ENGINE_MODE_AVX_STR             "AVX"
+#define ENGINE_MODE_AUTO_STR           "Auto"
+
+// ========================================================================== 
+// ================================ Dtype ===================================
+// ==========================================================================
+// Storage type of Image elements; every dtype but f64 accumulates in float
+#define DTYPE_F32                     0
+#define DTYPE_F64                     1
+#define DTYPE_F16                     2      // IEEE half, F16C conversions
+#define DTYPE_BF16                    3      // upper 16 bits of a float
+#define DTYPE_NONE                   -1
+
+#define DTYPE_F32_STR               "f32"
+#define DTYPE_F64_STR               "f64"
+#define DTYPE_F16_STR               "f16"
+#define DTYPE_BF16_STR             "bf16"
 
 // ========================================================================== 
 // ============================= Color Mode =================================
@@ -53,6 +82,7 @@
 #define CODE_FAILURE_FILE_NOT_FOUND     -8
 #define CODE_FAILURE_NOT_IMPLEMENTED    -9
 #define CODE_FAILURE_ARG_REQUIRED      -10
+#define CODE_FAILURE_OUT_OF_MEMORY     -11
 
 // ========================================================================== 
 // ============================= Log Level ==================================
@@ -61,6 +91,7 @@
 #define LOG_LEVEL_DEBUG              "[DEBUG]"
 #define LOG_LEVEL_WARNING          "[WARNING]"
 #define LOG_LEVEL_TIMING            "[TIMING]"
+#define LOG_LEVEL_PERF                "[PERF]"
 
 // ========================================================================== 
 // ============================= Kernel Type ================================
@@ -89,6 +120,91 @@
 #define KERNEL_SIZE_5_STR            "5 × 5"
 #define KERNEL_SIZE_7_STR            "7 × 7"
 
+// ========================================================================== 
+// ============================ Kernel Registry =============================
+// ==========================================================================
+#define KERNEL_TAP_LANES             8      // floats per pre-broadcast tap (one __m256)
+#define KERNEL_SIGMA_DEF             0.0f   // Gaussian sigma of 0 means size / 3
+#define KERNEL_SEPARABLE_EPS         1e-6f  // relative rank-1 tolerance
+
+// Kernel::symmetry bits (mirror about the centre column / centre row)
+#define KERNEL_SYMMETRY_NONE         0
+#define KERNEL_SYMMETRIC_H           1      // k[y][x] ==  k[y][size-1-x]
+#define KERNEL_SYMMETRIC_V           2      // k[y][x] ==  k[size-1-y][x]
+#define KERNEL_ANTISYMMETRIC_H       4      // k[y][x] == -k[y][size-1-x]
+#define KERNEL_ANTISYMMETRIC_V       8      // k[y][x] == -k[size-1-y][x]
+
+// ========================================================================== 
+// =============================== Pyramid ==================================
+// ==========================================================================
+#define PYRAMID_TYPE_GAUSSIAN        1
+#define PYRAMID_TYPE_LAPLACIAN       2
+#define PYRAMID_TYPE_NONE           -1
+
+#define PYRAMID_TYPE_GAUSSIAN_STR    "Gaussian"
+#define PYRAMID_TYPE_LAPLACIAN_STR   "Laplacian"
+
+#define PYRAMID_LEVELS_DEF           4
+#define PYRAMID_MAX_LEVELS          16
+#define PYRAMID_ROW_ALIGN            8      // floats; level rows start 32-byte aligned
+#define PYRAMID_TAPS                 5      // binomial 1 4 6 4 1 per axis
+
+// ========================================================================== 
+// =============================== Autotune =================================
+// ==========================================================================
+#define TUNE_CACHE_PATH_DEF         "conv2d.tune"
+#define TUNE_CACHE_HEADER           "# conv2d tuning cache v2"
+#define TUNE_WARMUP                 1
+#define TUNE_REPS                   5      // timed runs per candidate, median kept
+#define TUNE_MAX_THREADS           16
+
+// ========================================================================== 
+// ================================ Batch ===================================
+// ==========================================================================
+#define BATCH_CHUNK_PIXELS          65536  // output pixels per batch work item
+
+// ========================================================================== 
+// ============================ Check / Bench ===============================
+// ==========================================================================
+#define CHECK_SEED                  20240607u
+#define CHECK_TRIALS              400
+#define CHECK_CANARY               -12345.0f    // fills output buffers around the view
+
+#define BENCH_SEED                  1u
+#define BENCH_WARMUP                3
+#define BENCH_REPS                 21     // fastest run is compared
+#define BENCH_THRESHOLD_DEF        10.0     // percent slower than the baseline
+#define BENCH_BASELINE_PATH_DEF     "bench.baseline"
+
+// ========================================================================== 
+// ================================ Trace ===================================
+// ==========================================================================
+#define TRACE_RING_EVENTS           (1 << 16)   // per thread; oldest dropped first
+
+// ========================================================================== 
+// ============================= CNN Inference ==============================
+// ==========================================================================
+#define CNN_INPUT_HEIGHT            64
+#define CNN_INPUT_WIDTH             64
+#define CNN_TENSOR_EXT              ".bin"   // preprocessed float32 input
+#define CNN_PIXEL_SCALE             (1.0f / 255.0f)
+
+// ========================================================================== 
+// ============================ Report Format ===============================
+// ==========================================================================
+#define REPORT_FORMAT_TEXT           1
+#define REPORT_FORMAT_JSON           2
+#define REPORT_FORMAT_CSV            3
+#define REPORT_FORMAT_NONE          -1
+
+// ========================================================================== 
+// ============================= Serve Mode =================================
+// ==========================================================================
+#define SERVE_SOCKET_PATH_DEF      "/tmp/conv2d.sock"
+#define SERVE_MAGIC                0x44325643   // "CV2D"
+#define SERVE_MAX_FLOATS           (1 << 28)    // 1 GiB per request payload
+#define SERVE_POLL_MS              200
+
 /******************************** MISC *********************************/
 
 // ========================================================================== 
@@ -96,4 +212,14 @@
 // ==========================================================================
 #define SML_BUF_SIZE                64
 #define MED_BUF_SIZE               256
-#define LRG_BUF_SIZE              1024
\ No newline at end of file
+#define LRG_BUF_SIZE              1024
+
+// ========================================================================== 
+// ============================= Buffer Pool ================================
+// ==========================================================================
+#define MEMORY_ALIGNMENT            64
+
+#define POOL_MIN_CLASS_SHIFT         8   // smallest size class: 256 bytes
+#define POOL_NUM_SIZE_CLASSES       19   // largest pooled class: 64 MiB
+#define POOL_MAX_CACHED_PER_CLASS   32
+#define POOL_MAX_CACHED_BYTES       ((size_t) 512 << 20)   // 512 MiB cached at most
@@ -1,16 +1,65 @@
 #pragma once  
 
+#include <cstddef>
+
+#include "constants.h"
+
+// An Image is a view: row_stride is the distance in elements between rows
+// and channel_stride the distance between channel planes. Zero means packed,
+// so a plain {data, h, w, c} image is contiguous planar storage.
+//
+// data holds dtype elements (DTYPE_*); only f32 images may be read through
+// it as floats. Engines take any dtype, the rest of the project f32 only.
 struct Image {
-    float *data;
-    int height;
-    int width;
-    int channels;
+    float *data        = nullptr;
+    int height         = 0;
+    int width          = 0;
+    int channels       = 0;
+    int row_stride     = 0;
+    int channel_stride = 0;
+    int dtype          = DTYPE_F32;
 };
 
+inline size_t dtype_size(int dtype) {
+    switch (dtype) {
+        case DTYPE_F64:  return 8;
+        case DTYPE_F16:
+        case DTYPE_BF16: return 2;
+        default:         return 4;
+    }
+}
+
+// Floats of tensor_alloc() storage needed for count elements of dtype
+inline size_t dtype_storage_floats(int dtype, size_t count) {
+    return (count * dtype_size(dtype) + sizeof(float) - 1) / sizeof(float);
+}
+
+// Address of element e (in dtype elements) counted from image.data
+inline float* image_element(const Image& image, size_t e) {
+    return reinterpret_cast<float*>(reinterpret_cast<char*>(image.data) + e * dtype_size(image.dtype));
+}
+
+inline int image_row_stride(const Image& image) {
+    return image.row_stride ? image.row_stride : image.width;
+}
+
+inline size_t image_channel_stride(const Image& image) {
+    return image.channel_stride 
+        ? (size_t) image.channel_stride 
+        : (size_t) image.height * image_row_stride(image);
+}
+
+// taps is optional: registry kernels carry every tap pre-broadcast to
+// KERNEL_TAP_LANES floats (32-byte aligned) so engines load instead of splat.
+// symmetry holds KERNEL_SYMMETRIC_* / KERNEL_ANTISYMMETRIC_* bits; when set,
+// the SIMD engines fold mirrored pixels before multiplying.
 struct Kernel {
-    float *data;
-    int type; 
-    int size; 
+    float *data = nullptr;
+    int type    = KERNEL_TYPE_NONE; 
+    int size    = 0; 
+
+    const float *taps = nullptr;
+    int symmetry      = KERNEL_SYMMETRY_NONE;
 };
 
 struct Conv2DParams {
@@ -23,4 +72,100 @@ int conv2d_channels(
     int engine_mode, 
     const Conv2DParams& params, 
     Image& output
-);
\ No newline at end of file
+);
+
+// Engines write straight into the caller's view, honoring its strides, so
+// the result can land in a sub-region of a larger (tiled or padded) buffer.
+// ENGINE_MODE_AUTO runs the engine, tile and thread count the tuning cache
+// holds for this shape, benchmarking candidates first if it has none.
+int conv2d_channels_into(
+    int engine_mode, 
+    const Conv2DParams& params, 
+    const Image& output
+);
+
+// ==========================================================================
+// ============================ Reentrant API ===============================
+// ==========================================================================
+
+// Result of a conv2d_channels_ws() call. message is set on failure only.
+struct Conv2DStatus {
+    int  code        = CODE_SUCCESS;
+    int  engine_mode = ENGINE_MODE_NONE;    // engine that actually ran
+    bool fallback    = false;               // requested engine could not take
+                                            // the kernel; baseline ran instead
+    char message[MED_BUF_SIZE];
+};
+
+// Scratch floats conv2d_channels_ws() needs for these parameters. Query once
+// per thread (or per shape) and keep the buffer; a larger one is always fine.
+size_t conv2d_workspace_size(
+    int engine_mode,
+    const Conv2DParams& params
+);
+
+// conv2d_channels_into() for concurrent callers: never allocates, never
+// logs, touches no shared mutable state. workspace must hold at least
+// conv2d_workspace_size() floats (it may be null when that is 0). Returns
+// status.code.
+int conv2d_channels_ws(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    float *workspace,
+    size_t workspace_floats,
+    Conv2DStatus& status
+);
+
+// Splits the output into bands of tile_rows rows (0 = one band per thread)
+// and convolves them on threads workers through conv2d_channels_ws(); the
+// calling thread is one of them. engine_mode must be a concrete engine.
+int conv2d_channels_tiled(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    int tile_rows,
+    int threads
+);
+
+// ==========================================================================
+// ============================== Batch API =================================
+// ==========================================================================
+
+// Convolves count images with one kernel in a single call, for directories
+// of small images where per-call overhead dominates. Every argument is
+// checked before any work starts; threads workers (0 = one per core) then
+// take whole small images or bands of large ones from a shared queue.
+// Registry kernels keep their pre-broadcast taps for the whole batch.
+// outputs[i] must hold the result of inputs[i], as for
+// conv2d_channels_into(). ENGINE_MODE_AUTO looks up (or tunes) each image's
+// shape and runs its tuned engine; only the engine is taken, the batch's
+// banding and worker count replace the tuned tile and threads.
+int conv2d_batch(
+    int engine_mode,
+    const Kernel& kernel,
+    int stride,
+    const Image *inputs,
+    const Image *outputs,
+    size_t count,
+    int threads
+);
+
+// Sub-region view of an image; shares the parent's storage and strides.
+Image image_roi(
+    const Image& image,
+    int y,
+    int x,
+    int height,
+    int width
+);
+
+// False when the engine would fall back to the baseline for this kernel.
+bool conv2d_engine_supports(int engine_mode, int kernel_size);
+
+// 0 x 0 for a stride below 1, so callers' size checks reject it.
+void conv2d_output_size(
+    const Conv2DParams& params,
+    int& out_height,
+    int& out_width
+);
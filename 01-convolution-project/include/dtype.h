@@ -0,0 +1,43 @@
+#pragma once
+
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+
+#include "conv2d.h"
+
+// ==========================================================================
+// ========================== Scalar Conversions ============================
+// ==========================================================================
+
+inline float half_to_float(uint16_t h) {
+    return _cvtsh_ss(h);
+}
+
+inline uint16_t float_to_half(float f) {
+    return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+}
+
+inline float bf16_to_float(uint16_t b) {
+    uint32_t bits = (uint32_t) b << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Round to nearest even on the dropped 16 bits. NaNs with only low payload
+// bits set round to infinity; images never hold NaNs on purpose.
+inline uint16_t float_to_bf16(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return (uint16_t) (bits >> 16);
+}
+
+// ==========================================================================
+// ============================ Image Conversion ============================
+// ==========================================================================
+
+// Element-wise copy of src into dst, converting between dtypes. Both views
+// must have the same height, width and channels; strides may differ.
+int image_convert(const Image& src, const Image& dst);
@@ -2,6 +2,8 @@
 
 #include <string> 
 
+#include "constants.h"
+
 struct FunctionalTestParams {
     int engine_mode; 
     int kernel_type;
@@ -12,6 +14,10 @@ struct FunctionalTestParams {
     std::string output_dir;
 
     bool save_output = false;
+
+    bool perf_counters = false;
+
+    int dtype = DTYPE_F32;      // storage the engine runs on
 };
 
 int read_functional_test_input(FunctionalTestParams& functional_test_params);
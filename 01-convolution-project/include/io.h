@@ -3,6 +3,8 @@
 #include <string> 
 #include "conv2d.h"
 
+namespace cv { class Mat; }
+
 // std::string build_output_filename(
     
 // ) {
@@ -29,6 +31,20 @@ int save_float_array_as_rgb_image(
     const Image& image
 );
 
+// Dispatch on COLOR_MODE_*; print the failing path on error.
+int load_image_as(
+    int color_mode,
+    const std::string& image_path,
+    Image& image
+);
+
+// Accepts any dtype; non-f32 images are converted to f32 first.
+int save_image_as(
+    int color_mode,
+    const char *output_filename,
+    const Image& output
+);
+
 int load_kernel_from_file(
     const char* path,
     Kernel& kernel
@@ -45,7 +61,11 @@ float* load_vector(
     int size
 );
 
+// Replaces image (which must own pooled storage) with a packed, bilinearly
+// resized copy of all its channels; see resize_channels_into(). Strided
+// views and non-f32 images are rejected with CODE_FAILURE_INVALID_ARG.
 int resize_image(
+    int engine_mode,
     Image& image, 
     int new_width, 
     int new_height
@@ -54,4 +74,26 @@ int resize_image(
 int load_tensor(
     const std::string& path,
     Image& image
-);
\ No newline at end of file
+);
+
+// Wraps a CV_32FC1 matrix (padded rows allowed) as an Image view, no copy.
+// The view is only valid while the matrix is alive.
+int image_from_mat(
+    const cv::Mat& mat,
+    Image& image
+);
+
+// Converts an 8-bit BGR or grey video frame into a preallocated planar
+// float Image (RGB order, [0, 1]); converts between 1 and 3 channels as
+// needed. Allocation free, so it can run per frame.
+int frame_to_image(
+    const cv::Mat& frame,
+    const Image& image
+);
+
+// Clamps a planar float Image into an 8-bit BGR or grey frame, reusing the
+// frame's storage when its geometry already matches.
+int image_to_frame(
+    const Image& image,
+    cv::Mat& frame
+);
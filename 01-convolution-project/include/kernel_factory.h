@@ -1,5 +1,47 @@
 #pragma once
 
+#include <memory>
+
 #include "conv2d.h"
 
-int get_kernel(int kernel_type, int kernel_size, Kernel& kernel);
\ No newline at end of file
+// ==========================================================================
+// ============================ Kernel Registry =============================
+// ==========================================================================
+
+// A registered kernel is built once per (type, size, sigma) and never changes
+// afterwards, so any number of threads may read it without locking. All
+// arrays are MEMORY_ALIGNMENT aligned and owned by the entry.
+struct KernelEntry {
+    Kernel kernel;          // taps points at the broadcast taps below,
+                            // symmetry is filled in from the tap values
+    float  sigma = 0.0f;    // resolved Gaussian sigma, 0 for other types
+
+    // size * size taps, each repeated KERNEL_TAP_LANES times
+    float *taps = nullptr;
+
+    // kernel == col * row^T (box, Gaussian, Sobel); row/col hold size taps
+    bool   separable = false;
+    float *row = nullptr;
+    float *col = nullptr;
+
+    KernelEntry() = default;
+    KernelEntry(const KernelEntry&) = delete;
+    KernelEntry& operator=(const KernelEntry&) = delete;
+    ~KernelEntry();
+};
+
+typedef std::shared_ptr<const KernelEntry> KernelRef;
+
+// Looks up or builds the kernel; sigma is only used by the Gaussian blur and
+// KERNEL_SIGMA_DEF selects size / 3. Safe to call from any thread; the entry
+// stays valid for as long as the reference is held.
+int get_kernel_ref(int kernel_type, int kernel_size, float sigma, KernelRef& ref);
+
+// Odd sizes of at least 3, the only ones the kernel builders take.
+bool validate_odd_kernel(int k);
+
+// KERNEL_SYMMETRIC_* / KERNEL_ANTISYMMETRIC_* bits of a size x size kernel.
+int find_kernel_symmetry(const float *data, int size);
+
+// Drops the registry's own references; entries still held elsewhere survive.
+void clear_kernel_registry();
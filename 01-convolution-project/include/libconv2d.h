@@ -0,0 +1,170 @@
+#ifndef LIBCONV2D_H
+#define LIBCONV2D_H
+
+/*
+ * Stable C API of libconv2d (bin/libconv2d.a, bin/libconv2d.so).
+ *
+ * Every call returns CONV2D_OK or a negative CONV2D_ERROR_* code and never
+ * writes to stdout/stderr; conv2d_last_error() describes the latest failure
+ * on the calling thread. Handles are opaque. Images are planar float32,
+ * laid out like the engine's own Image: channel c, row y starts at
+ * data + c * channel_stride + y * row_stride (0 strides mean packed).
+ *
+ * Compatibility: functions and structs are only ever added in minor
+ * versions; a major bump (and soname change) is required to alter them.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONV2D_API_VERSION_MAJOR    1
+#define CONV2D_API_VERSION_MINOR    3
+#define CONV2D_API_VERSION_PATCH    0
+
+#define CONV2D_API_VERSION \
+    ((CONV2D_API_VERSION_MAJOR << 16) | (CONV2D_API_VERSION_MINOR << 8) | CONV2D_API_VERSION_PATCH)
+
+/* Return codes (same values as the CLI's CODE_*) */
+#define CONV2D_OK                        0
+#define CONV2D_ERROR                    -1
+#define CONV2D_ERROR_INVALID_ARG        -2
+#define CONV2D_ERROR_READ_INPUT         -3
+#define CONV2D_ERROR_INVALID_INPUT      -5
+#define CONV2D_ERROR_NOT_SUPPORTED      -7
+#define CONV2D_ERROR_FILE_NOT_FOUND     -8
+#define CONV2D_ERROR_OUT_OF_MEMORY     -11
+
+/* Engines; any other value is rejected with CONV2D_ERROR_INVALID_ARG */
+#define CONV2D_ENGINE_BASELINE           1
+#define CONV2D_ENGINE_SSE                2
+#define CONV2D_ENGINE_AVX                3
+
+/* Built-in kernels */
+#define CONV2D_KERNEL_SHARPEN            1
+#define CONV2D_KERNEL_BOX_BLUR           2
+#define CONV2D_KERNEL_GAUSSIAN_BLUR      3
+#define CONV2D_KERNEL_SOBEL_X            4
+#define CONV2D_KERNEL_SOBEL_Y            5
+
+typedef struct conv2d_image {
+    float *data;
+    int height;
+    int width;
+    int channels;
+    int row_stride;         /* floats between rows, 0 = width */
+    int channel_stride;     /* floats between channels, 0 = row_stride * height */
+} conv2d_image;
+
+typedef struct conv2d_kernel conv2d_kernel;
+typedef struct conv2d_model  conv2d_model;
+
+/* Version the library was built with (CONV2D_API_VERSION layout) */
+int conv2d_api_version(void);
+
+const char* conv2d_last_error(void);
+
+/*
+ * Optional diagnostics sink; is_error is 0 for warnings. NULL disables.
+ * Not thread-safe: set it before any thread calls into the library and do
+ * not change it while calls are running.
+ */
+typedef void (*conv2d_log_fn)(int is_error, const char *msg, int code, void *user);
+void conv2d_set_log_callback(conv2d_log_fn fn, void *user);
+
+/* 64-byte aligned float buffers from the library's pool (since 1.1) */
+float* conv2d_buffer_alloc(size_t count);
+void conv2d_buffer_free(float *data);
+
+/* Kernels */
+int conv2d_kernel_create(int kernel_type, int kernel_size, conv2d_kernel **out);
+/* kernel_size must be odd and at least 3; data is copied */
+int conv2d_kernel_create_from_data(const float *data, int kernel_size, conv2d_kernel **out);
+int conv2d_kernel_size(const conv2d_kernel *kernel);
+const float* conv2d_kernel_data(const conv2d_kernel *kernel);     /* since 1.1 */
+void conv2d_kernel_free(conv2d_kernel *kernel);
+
+/* Convolution */
+int conv2d_output_shape(
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    int *out_height,
+    int *out_width
+);
+
+/* output must be at least conv2d_output_shape() x input->channels */
+int conv2d_convolve(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    const conv2d_image *output
+);
+
+/*
+ * Reentrant convolution for concurrent callers (since 1.3): no allocation,
+ * no logging and no conv2d_last_error() update; the outcome is returned in
+ * *status. Query the workspace size once per thread or shape and reuse the
+ * buffer (conv2d_buffer_alloc() or any float memory); NULL is allowed when
+ * the size is 0.
+ */
+#define CONV2D_STATUS_MESSAGE_LEN      256
+
+typedef struct conv2d_status {
+    int code;                   /* same as the return value */
+    int engine;                 /* engine that actually ran */
+    int fallback;               /* 1 when engine could not take the kernel */
+    char message[CONV2D_STATUS_MESSAGE_LEN];    /* set on failure only */
+} conv2d_status;
+
+int conv2d_workspace_size(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    size_t *count
+);
+
+int conv2d_convolve_ws(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    const conv2d_image *output,
+    float *workspace,
+    size_t workspace_count,
+    conv2d_status *status
+);
+
+/* Bilinear resize of every channel to output's height x width (since 1.2) */
+int conv2d_resize(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_image *output
+);
+
+/* CNN inference (conv 3x3 -> ReLU -> FC, 64x64 single-channel input) */
+int conv2d_model_load(
+    const char *kernel_path,
+    const char *fc_weight_path,
+    const char *fc_bias_path,
+    conv2d_model **out
+);
+
+int conv2d_infer(
+    int engine,
+    const conv2d_model *model,
+    const conv2d_image *input,
+    int *predicted_class
+);
+
+void conv2d_model_free(conv2d_model *model);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCONV2D_H */
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include "constants.h"
+
+struct LoadgenParams {
+    std::string socket_path = SERVE_SOCKET_PATH_DEF;
+
+    int engine_mode;
+    int kernel_type;
+    int kernel_size;
+    int color_mode;
+
+    // SERVE_OP_PATH requests when set, else synthetic SERVE_OP_RAW frames
+    std::string input_path;
+    std::string output_path;
+
+    int requests   = 1000;  // total, split across clients
+    int clients    = 1;     // concurrent connections
+    int frame_size = 512;   // raw frame side length
+
+    // Synthetic frames go through a shared-memory ring instead of the socket
+    bool shm   = false;
+    int  slots = 4;         // even: slots are used as input/output pairs
+};
+
+// Drives a running server and reports requests/s and latency percentiles.
+int run_loadgen(const LoadgenParams& loadgen_params);
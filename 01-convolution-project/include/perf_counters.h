@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+enum PerfEvent {
+    PERF_EVENT_CYCLES = 0,
+    PERF_EVENT_INSTRUCTIONS,
+    PERF_EVENT_L1D_MISSES,
+    PERF_EVENT_LLC_MISSES,
+    PERF_EVENT_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+};
+
+// Accumulated counts over any number of start/stop windows. Counters the
+// kernel refused to open (containers, perf_event_paranoid) stay invalid.
+struct PerfSample {
+    uint64_t counts[PERF_EVENT_COUNT] = {};
+    bool     valid [PERF_EVENT_COUNT] = {};
+
+    double bytes = 0.0;     // compulsory traffic: input + output
+    int windows  = 0;
+};
+
+struct PerfCounters {
+    int fds[PERF_EVENT_COUNT] = { -1, -1, -1, -1, -1 };
+    bool available = false;
+};
+
+// Opens every counter it can; returns CODE_FAILURE_NOT_SUPPORTED (and warns
+// once) when none are available so callers can carry on uninstrumented.
+int perf_counters_open(PerfCounters& counters);
+void perf_counters_close(PerfCounters& counters);
+
+void perf_counters_start(const PerfCounters& counters);
+void perf_counters_stop(const PerfCounters& counters, PerfSample& sample);
+
+void print_perf_report(int engine_mode, const PerfSample& sample);
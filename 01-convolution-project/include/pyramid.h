@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "conv2d.h"
+
+// Gaussian or Laplacian pyramid whose levels, scratch plane and row buffer
+// all live in one pooled arena. Level 0 has the input's size and level i + 1
+// is (h + 1) / 2 x (w + 1) / 2 of level i. Level rows are padded to
+// PYRAMID_ROW_ALIGN floats, so every level is a strided view.
+struct Pyramid {
+    std::vector<Image> levels;
+
+    // Level-0 sized planes the caller may use freely (e.g. filter outputs)
+    Image scratch;
+
+    // Vertical-pass row of the fused downsampler
+    float *rows = nullptr;
+
+    float *arena        = nullptr;
+    size_t arena_floats = 0;
+};
+
+// Lays out levels for a height x width x channels input; stops early once a
+// level is 1 x 1. The arena is reused when it is already large enough, so a
+// Pyramid kept across images of similar size allocates only once.
+int pyramid_reserve(
+    Pyramid& pyramid,
+    int height,
+    int width,
+    int channels,
+    int levels
+);
+
+// Builds every level from input with the fused blur-and-decimate pass: the
+// binomial 1 4 6 4 1 kernel in both directions evaluated only at even
+// positions, reflect-101 borders.
+//   PYRAMID_TYPE_GAUSSIAN:  levels are the blurred, decimated images
+//   PYRAMID_TYPE_LAPLACIAN: level i becomes G(i) - expand(G(i + 1)) in place;
+//                           the last level keeps the Gaussian residual
+int build_pyramid(
+    int engine_mode,
+    int pyramid_type,
+    const Image& input,
+    int levels,
+    Pyramid& pyramid
+);
+
+void free_pyramid(Pyramid& pyramid);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "constants.h"
+
+// One entry of the filter bank; name is the CLI spelling used in file names
+struct FilterSpec {
+    int kernel_type;
+    int kernel_size;
+    std::string name;
+};
+
+struct PyramidParams {
+    int engine_mode;
+    int pyramid_type;
+    int levels;
+    int color_mode;
+
+    std::string input;
+
+    // Output file name; each level is written as <stem>_l<level><ext> and
+    // each filter result as <stem>_l<level>_<filter><ext>. Empty to discard.
+    std::string output;
+
+    // Run on every level after the pyramid is built; may be empty
+    std::vector<FilterSpec> bank;
+};
+
+int run_pyramid(const PyramidParams& pyramid_params);
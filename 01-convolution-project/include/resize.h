@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "conv2d.h"
+
+// Bilinear resize with PIL's pixel-centre mapping, applied to every channel.
+// The target size is output's height x width; both views' strides are
+// honoured, so the result can land inside a larger buffer. f32 images only.
+//   ENGINE_MODE_BASELINE: per-pixel reference loop
+//   ENGINE_MODE_SSE/AVX:  source indices and weights computed once per row
+//                         and column, rows interpolated with SIMD (AVX2 also
+//                         gathers the horizontal taps)
+int resize_channels_into(
+    int engine_mode,
+    const Image& input,
+    const Image& output
+);
+
+// Source taps and weight for every output position along one axis; the same
+// mapping and clamping as the baseline, evaluated once instead of per pixel.
+// out[o] = in[i0[o]] + w[o] * (in[i1[o]] - in[i0[o]])
+struct ResizeAxis {
+    std::vector<int>   i0;
+    std::vector<int>   i1;
+    std::vector<float> w;
+};
+
+void build_resize_axis(int in_size, int out_size, ResizeAxis& axis);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "constants.h"
+
+struct RooflineParams {
+    int engine_mode = ENGINE_MODE_NONE;     // all engines when NONE
+    int kernel_size = 0;                    // 3, 5 and 7 when 0
+    int cpu         = -1;
+};
+
+int run_roofline(const RooflineParams& roofline_params);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "constants.h"
+
+// ==========================================================================
+// ============================ Wire Protocol ===============================
+// ==========================================================================
+
+// Every message starts with a fixed-size header in host byte order (the
+// socket is local). Variable-length data follows the header:
+//   SERVE_OP_PATH: input path, then output path (input_len/output_len bytes)
+//   SERVE_OP_RAW:  height * width * channels floats, planar like Image
+//   SERVE_OP_SHM_ATTACH: shared-memory ring name (input_len bytes)
+// The response to SERVE_OP_RAW carries the output floats after its header.
+// SERVE_OP_SHM sends nothing after the header: the frame is already in
+// input_slot of the attached ring and the result lands in output_slot.
+enum ServeOp {
+    SERVE_OP_PATH       = 1,
+    SERVE_OP_RAW        = 2,
+    SERVE_OP_SHM_ATTACH = 3,
+    SERVE_OP_SHM        = 4,
+};
+
+struct ServeRequest {
+    uint32_t magic;
+    int32_t  op;
+
+    int32_t  engine_mode;
+    int32_t  kernel_type;
+    int32_t  kernel_size;
+    int32_t  color_mode;    // SERVE_OP_PATH only
+
+    int32_t  height;        // SERVE_OP_RAW / SERVE_OP_SHM
+    int32_t  width;
+    int32_t  channels;
+
+    uint32_t input_len;     // SERVE_OP_PATH; output_len may be 0
+    uint32_t output_len;
+
+    int32_t  input_slot;    // SERVE_OP_SHM only
+    int32_t  output_slot;
+};
+
+struct ServeResponse {
+    uint32_t magic;
+    int32_t  status;        // CODE_SUCCESS or a CODE_FAILURE_* value
+
+    int32_t  height;
+    int32_t  width;
+    int32_t  channels;
+
+    double   conv_ms;       // engine time only, excludes decode and transfer
+};
+
+// Loop until len bytes are transferred; false on EOF or error.
+bool serve_send_all(int fd, const void *data, size_t len);
+bool serve_recv_all(int fd, void *data, size_t len);
+
+// Connects to the server socket; returns the fd or -1.
+int serve_connect(const std::string& socket_path);
+
+// ==========================================================================
+// ================================ Server ==================================
+// ==========================================================================
+
+struct ServeParams {
+    std::string socket_path = SERVE_SOCKET_PATH_DEF;
+
+    int workers     = 1;    // connections handled concurrently
+    int queue_depth = 8;    // accepted connections waiting for a worker
+    int cpu         = -1;
+};
+
+// Runs until SIGINT/SIGTERM. Kernels come from the shared kernel registry
+// (built once, read by every worker); image buffers come from the tensor pool.
+// Workers convolve through conv2d_channels_ws() with a per-connection
+// workspace; failures travel back in ServeResponse::status, not to stderr.
+int run_serve(const ServeParams& serve_params);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ==========================================================================
+// ======================= Shared-Memory Slot Ring ==========================
+// ==========================================================================
+
+// A POSIX shared-memory object split into equally sized slots. The owner
+// (the client) creates it and writes frames into slots; the server maps
+// the same object and convolves from an input slot straight into an
+// output slot, so only slot indices and sizes cross the socket. A slot
+// belongs to the server from the request until its response arrives.
+struct ShmRingHeader {
+    uint32_t magic;
+    int32_t  slots;
+    uint64_t slot_bytes;    // multiple of MEMORY_ALIGNMENT
+};
+
+struct ShmRing {
+    std::string name;
+
+    void  *base       = nullptr;
+    size_t size       = 0;
+    int    slots      = 0;
+    size_t slot_bytes = 0;
+
+    bool owner = false;     // unlinks the object on close
+};
+
+int shm_ring_create(
+    const std::string& name,
+    int slots,
+    size_t slot_bytes,
+    ShmRing& ring
+);
+
+int shm_ring_attach(
+    const std::string& name,
+    ShmRing& ring
+);
+
+void shm_ring_close(ShmRing& ring);
+
+// MEMORY_ALIGNMENT aligned start of a slot; nullptr when out of range.
+float* shm_ring_slot(const ShmRing& ring, int slot);
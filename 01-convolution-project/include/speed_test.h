@@ -2,6 +2,8 @@
 
 #include <string> 
 
+#include "constants.h"
+
 struct SpeedTestParams {
     int engine_mode;
     int kernel_type;
@@ -12,6 +14,28 @@ struct SpeedTestParams {
     std::string output_dir; 
 
     bool save_output = false;
+
+    // Benchmark harness: each repetition convolves the whole directory
+    int warmup        = 0;
+    int repetitions   = 1;
+    int cpu           = -1;     // pin to this CPU when >= 0
+    int report_format = REPORT_FORMAT_TEXT;
+
+    std::string report_path;    // stdout when empty
+
+    bool perf_counters = false;
+
+    // Overlapped decode -> convolve -> encode over bounded queues.
+    // Without the pipeline, decode_threads load the directory up front and
+    // conv_threads share the batch.
+    bool pipeline       = false;
+    int  decode_threads = 1;
+    int  conv_threads   = 1;
+    int  encode_threads = 1;
+    int  queue_depth    = 8;
+
+    // Images are converted to this storage after decoding
+    int dtype = DTYPE_F32;
 };
 
 int read_speed_test_params(SpeedTestParams& speed_test_params);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "constants.h"
+
+struct StreamParams {
+    int engine_mode;
+    int kernel_type;
+    int kernel_size;
+    int color_mode;
+
+    // Video file, or "-" for raw 8-bit frames (grey or bgr24) on stdin
+    std::string input;
+
+    // Video file, "-" for raw frames on stdout, or empty to discard
+    std::string output;
+
+    int frame_width  = 0;   // raw stdin only
+    int frame_height = 0;
+
+    int cpu = -1;
+};
+
+int run_stream(const StreamParams& stream_params);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+#include "conv2d.h"
+
+// ==========================================================================
+// ======================= Aligned Pooled Buffers ===========================
+// ==========================================================================
+
+// Every Image/Kernel buffer in the project comes from here. Buffers are
+// MEMORY_ALIGNMENT aligned and rounded up to a power-of-two size class;
+// released buffers are cached per class and handed out again, so repeated
+// conv calls on same-sized images stop hitting the system allocator. At
+// most POOL_MAX_CACHED_BYTES stay cached; buffers above the largest class
+// are allocated at their exact size and never cached.
+float* tensor_alloc(size_t count);
+void tensor_free(const float *data);
+
+// Drops every cached buffer back to the system allocator.
+void tensor_pool_trim();
+
+bool is_aligned(const void *ptr, size_t alignment);
+
+// Owning, move-only wrapper around a pooled Image buffer.
+class Tensor {
+public:
+    Tensor() = default;
+    Tensor(int height, int width, int channels, int dtype = DTYPE_F32);
+    ~Tensor();
+
+    Tensor(const Tensor&) = delete;
+    Tensor& operator=(const Tensor&) = delete;
+
+    Tensor(Tensor&& other) noexcept;
+    Tensor& operator=(Tensor&& other) noexcept;
+
+    // Takes ownership of image.data (must come from tensor_alloc).
+    static Tensor adopt(const Image& image);
+
+    // Gives up ownership; the caller must tensor_free() the returned data.
+    Image release();
+
+    void reset();
+
+    const Image& view() const { return image_; }
+    Image& view() { return image_; }
+
+    float* data() const { return image_.data; }
+    bool empty() const { return image_.data == nullptr; }
+
+    // Replaces the buffer with a packed copy converted to dtype; a no-op when
+    // the tensor already holds dtype.
+    int convert_to(int dtype);
+
+private:
+    Image image_ = { nullptr, 0, 0, 0 };
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Scoped stage timing for Chrome trace / Perfetto. Each thread appends
+// complete events to its own fixed-size ring (single writer, no locks on the
+// hot path); an exiting thread hands its ring to the next new one, and
+// trace_write_chrome_json() merges the rings once the work is done. When tracing is off a trace point costs a relaxed load of a global
+// flag and one well-predicted branch on it; the constructor latches the
+// flag so the destructor tests the same bool.
+//
+//     void decode(...) {
+//         TRACE_SCOPE("decode");
+//         ...
+//     }
+//
+// Names must be string literals (or otherwise outlive the trace).
+
+extern std::atomic<bool> trace_active;
+
+// Call before starting worker threads; events recorded earlier are kept.
+void trace_enable(bool enabled);
+
+// Nanoseconds on the steady clock, the time base of every event
+uint64_t trace_now_ns();
+
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+// Writes every thread's events as {"traceEvents": [...]} with "X" (complete)
+// events in microseconds. Threads still recording may lose their newest
+// events; call after joining them.
+int trace_write_chrome_json(const char *path);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name)
+        : name_(name), active_(trace_active.load(std::memory_order_relaxed)) {
+        if (active_)
+            start_ns_ = trace_now_ns();
+    }
+
+    ~TraceScope() {
+        if (active_)
+            trace_record(name_, start_ns_, trace_now_ns());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char *name_;
+    const bool active_;
+    uint64_t start_ns_ = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b)       TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "constants.h"
+
+struct TuneParams {
+    int kernel_type;
+    int kernel_size;
+    int color_mode;
+
+    // The shape comes from this image, or from frame_width x frame_height
+    // (channels from color_mode) when it is empty
+    std::string input;
+
+    int frame_width  = 0;
+    int frame_height = 0;
+
+    int dtype = DTYPE_F32;
+};
+
+// Benchmarks every candidate for the shape, prints the table and stores the
+// winner in the tuning cache, replacing any earlier entry.
+int run_tune(const TuneParams& tune_params);
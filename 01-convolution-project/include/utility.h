@@ -9,9 +9,28 @@ struct OptionEntry
     std::string option_name;
 };
 
+std::string get_engine_name(int engine_code);
+std::string get_kernel_type_name(int kernel_type);
+std::string get_color_mode_name(int color_mode);
+std::string get_dtype_name(int dtype);
+
 void print_benchmark(int engine_code, double elapsed);
 void print_err(const char *msg, int errcode);
 void print_warn(const char *msg);
+
+// print_err/print_warn go through a process-wide handler. There is none by
+// default so library code stays quiet; the CLI installs stderr_log_handler.
+// The last error is always kept per thread for last_error_message().
+enum LogKind {
+    LOG_KIND_ERROR,
+    LOG_KIND_WARNING
+};
+
+typedef void (*LogHandler)(int log_kind, const char *msg, int errcode, void *user);
+
+void set_log_handler(LogHandler handler, void *user);
+void stderr_log_handler(int log_kind, const char *msg, int errcode, void *user);
+const char* last_error_message();
 int safe_atoi(const char *s, int *out);
 int safe_atox(const char *s, unsigned int *out);
 bool is_hex_string(const char *s);
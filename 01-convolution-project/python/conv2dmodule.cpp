@@ -0,0 +1,607 @@
+// Python bindings for libconv2d (build with `make python`).
+//
+//     import conv2d, numpy as np
+//     img = np.random.rand(3, 512, 512).astype(np.float32)    # planar C,H,W
+//     k   = conv2d.get_kernel("gaussian_blur", 5)
+//     out = conv2d.conv2d_channels(img, k, engine="avx")
+//
+// Arrays cross the boundary through the buffer protocol: inputs (and an
+// optional `out=`) are used in place as long as each row is contiguous
+// float32, whatever the row/channel pitch; results live in pooled library
+// buffers that NumPy wraps without copying. The GIL is released while the
+// engines run, so Python threads can convolve in parallel.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <climits>
+#include <cstring>
+
+#include "libconv2d.h"
+
+#define MODEL_CAPSULE_NAME "conv2d.model"
+
+// ==========================================================================
+// ============================= Buffer Type ================================
+// ==========================================================================
+
+// Owns a pooled float array and exports it as a 2-D or 3-D float32 buffer
+struct BufferObject {
+    PyObject_HEAD
+    float      *data;
+    int         ndim;
+    Py_ssize_t  shape[3];
+    Py_ssize_t  strides[3];
+};
+
+static int buffer_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+    BufferObject *buffer = (BufferObject *) self;
+
+    Py_ssize_t count = 1;
+    for (int d = 0; d < buffer->ndim; d++)
+        count *= buffer->shape[d];
+
+    view->obj        = self;
+    view->buf        = buffer->data;
+    view->len        = count * (Py_ssize_t) sizeof(float);
+    view->itemsize   = sizeof(float);
+    view->readonly   = 0;
+    view->format     = (flags & PyBUF_FORMAT) ? (char *) "f" : nullptr;
+    view->ndim       = buffer->ndim;
+    view->shape      = buffer->shape;
+    view->strides    = buffer->strides;
+    view->suboffsets = nullptr;
+    view->internal   = nullptr;
+
+    Py_INCREF(self);
+    return 0;
+}
+
+static void buffer_dealloc(PyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+
+    conv2d_buffer_free(((BufferObject *) self)->data);
+    type->tp_free(self);
+
+    Py_DECREF(type);
+}
+
+static PyType_Slot buffer_slots[] = {
+    { Py_bf_getbuffer, (void *) buffer_getbuffer },
+    { Py_tp_dealloc,   (void *) buffer_dealloc },
+    { Py_tp_doc,       (void *) "Pooled float32 storage behind arrays returned by conv2d" },
+    { 0, nullptr }
+};
+
+static PyType_Spec buffer_spec = {
+    "conv2d.Buffer",
+    sizeof(BufferObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    buffer_slots
+};
+
+static PyTypeObject *BufferType = nullptr;
+
+static BufferObject* new_buffer(int ndim, const Py_ssize_t *shape) {
+    Py_ssize_t count = 1;
+    for (int d = 0; d < ndim; d++)
+        count *= shape[d];
+
+    float *data = conv2d_buffer_alloc((size_t) count);
+    if (!data)
+        return (BufferObject *) PyErr_NoMemory();
+
+    BufferObject *buffer = PyObject_New(BufferObject, BufferType);
+    if (!buffer) {
+        conv2d_buffer_free(data);
+        return nullptr;
+    }
+
+    buffer->data = data;
+    buffer->ndim = ndim;
+
+    Py_ssize_t stride = sizeof(float);
+    for (int d = ndim - 1; d >= 0; d--) {
+        buffer->shape[d]   = shape[d];
+        buffer->strides[d] = stride;
+        stride *= shape[d];
+    }
+
+    return buffer;
+}
+
+// numpy.asarray(buffer) when NumPy is installed (zero copy, the array keeps
+// the buffer alive), otherwise a memoryview.
+static PyObject* as_array(BufferObject *buffer) {
+    static PyObject *asarray = nullptr;
+    static bool looked_up    = false;
+
+    if (!looked_up) {
+        looked_up = true;
+
+        PyObject *numpy = PyImport_ImportModule("numpy");
+        if (numpy) {
+            asarray = PyObject_GetAttrString(numpy, "asarray");
+            Py_DECREF(numpy);
+        }
+        PyErr_Clear();
+    }
+
+    PyObject *result = asarray
+        ? PyObject_CallOneArg(asarray, (PyObject *) buffer)
+        : PyMemoryView_FromObject((PyObject *) buffer);
+
+    Py_DECREF(buffer);
+    return result;
+}
+
+// ==========================================================================
+// =============================== Helpers ==================================
+// ==========================================================================
+
+static PyObject* raise_error(int code) {
+    PyObject *type = PyExc_RuntimeError;
+
+    switch (code) {
+        case CONV2D_ERROR_INVALID_ARG:
+        case CONV2D_ERROR_INVALID_INPUT:
+        case CONV2D_ERROR_NOT_SUPPORTED:
+            type = PyExc_ValueError;
+            break;
+
+        case CONV2D_ERROR_READ_INPUT:
+        case CONV2D_ERROR_FILE_NOT_FOUND:
+            type = PyExc_OSError;
+            break;
+
+        case CONV2D_ERROR_OUT_OF_MEMORY:
+            type = PyExc_MemoryError;
+            break;
+    }
+
+    PyErr_SetString(type, conv2d_last_error());
+    return nullptr;
+}
+
+// Accepts a name or one of the matching integer codes, nothing else
+static int parse_name(PyObject *value, const char *const *names, const int *codes, int count, const char *what) {
+    if (PyLong_Check(value)) {
+        long code = PyLong_AsLong(value);
+
+        for (int i = 0; !PyErr_Occurred() && i < count; i++) {
+            if (code == codes[i])
+                return codes[i];
+        }
+
+        PyErr_Clear();
+        PyErr_Format(PyExc_ValueError, "unknown %s", what);
+        return -1;
+    }
+
+    const char *name = PyUnicode_Check(value) ? PyUnicode_AsUTF8(value) : nullptr;
+
+    for (int i = 0; name && i < count; i++) {
+        if (std::strcmp(name, names[i]) == 0)
+            return codes[i];
+    }
+
+    PyErr_Format(PyExc_ValueError, "unknown %s", what);
+    return -1;
+}
+
+static int parse_engine(PyObject *value) {
+    static const char *const names[] = { "baseline", "sse", "avx" };
+    static const int codes[] = { CONV2D_ENGINE_BASELINE, CONV2D_ENGINE_SSE, CONV2D_ENGINE_AVX };
+
+    return parse_name(value, names, codes, 3, "engine (baseline | sse | avx)");
+}
+
+static int parse_kernel_type(PyObject *value) {
+    static const char *const names[] = { "sharpen", "box_blur", "gaussian_blur", "sobel_x", "sobel_y" };
+    static const int codes[] = {
+        CONV2D_KERNEL_SHARPEN, CONV2D_KERNEL_BOX_BLUR, CONV2D_KERNEL_GAUSSIAN_BLUR,
+        CONV2D_KERNEL_SOBEL_X, CONV2D_KERNEL_SOBEL_Y
+    };
+
+    return parse_name(value, names, codes, 5, "kernel type");
+}
+
+// Native or little-endian float32 only; '>f' would be read byte-swapped
+static bool is_float32_format(const Py_buffer& view) {
+    const char *format = view.format ? view.format : "B";
+    if (format[0] == '<' || format[0] == '=' || format[0] == '@')
+        format++;
+
+    return std::strcmp(format, "f") == 0 && view.itemsize == sizeof(float);
+}
+
+// Maps a 2-D (H, W) or 3-D (C, H, W) float32 buffer with contiguous rows
+// onto conv2d_image; row and channel pitch are passed through as strides.
+static int get_image(PyObject *obj, int flags, Py_buffer& view, conv2d_image& image) {
+    if (PyObject_GetBuffer(obj, &view, flags | PyBUF_STRIDES | PyBUF_FORMAT) != 0)
+        return -1;
+
+    bool ok = is_float32_format(view) && (view.ndim == 2 || view.ndim == 3);
+
+    for (int d = 0; ok && d < view.ndim; d++) {
+        ok = view.shape[d] > 0 && view.shape[d] <= INT_MAX &&
+             view.strides[d] > 0 && view.strides[d] % sizeof(float) == 0 &&
+             view.strides[d] / (Py_ssize_t) sizeof(float) <= INT_MAX;
+    }
+
+    if (!ok || view.strides[view.ndim - 1] != sizeof(float)) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError,
+            "expected a float32 (H, W) or planar (C, H, W) array with contiguous rows "
+            "(use np.ascontiguousarray(img.transpose(2, 0, 1)) for H, W, C images)");
+        return -1;
+    }
+
+    bool planar = view.ndim == 3;
+
+    image.data           = (float *) view.buf;
+    image.channels       = planar ? (int) view.shape[0] : 1;
+    image.height         = (int) view.shape[view.ndim - 2];
+    image.width          = (int) view.shape[view.ndim - 1];
+    image.row_stride     = (int) (view.strides[view.ndim - 2] / sizeof(float));
+    image.channel_stride = planar ? (int) (view.strides[0] / sizeof(float)) : 0;
+
+    return 0;
+}
+
+// Address ranges from the first to one past the last element; a conservative
+// test, interleaved views that share no element still count as overlapping
+static bool images_overlap(const conv2d_image& a, const conv2d_image& b) {
+    auto end = [](const conv2d_image& img) {
+        return img.data
+            + (size_t) (img.channels - 1) * img.channel_stride
+            + (size_t) (img.height - 1) * img.row_stride
+            + img.width;
+    };
+
+    return a.data < end(b) && b.data < end(a);
+}
+
+static int get_kernel_buffer(PyObject *obj, conv2d_kernel **kernel) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+        return -1;
+
+    bool ok = view.ndim == 2 && view.shape[0] == view.shape[1] && is_float32_format(view);
+
+    if (!ok) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "kernel must be a square C-contiguous float32 array");
+        return -1;
+    }
+
+    int res = conv2d_kernel_create_from_data((const float *) view.buf, (int) view.shape[0], kernel);
+    PyBuffer_Release(&view);
+
+    if (res != CONV2D_OK) {
+        raise_error(res);
+        return -1;
+    }
+
+    return 0;
+}
+
+// ==========================================================================
+// =============================== Methods ==================================
+// ==========================================================================
+
+static PyObject* py_get_kernel(PyObject *, PyObject *args) {
+    PyObject *type_obj;
+    int size;
+
+    if (!PyArg_ParseTuple(args, "Oi", &type_obj, &size))
+        return nullptr;
+
+    int kernel_type = parse_kernel_type(type_obj);
+    if (PyErr_Occurred())
+        return nullptr;
+
+    conv2d_kernel *kernel;
+    int res = conv2d_kernel_create(kernel_type, size, &kernel);
+    if (res != CONV2D_OK)
+        return raise_error(res);
+
+    Py_ssize_t shape[2] = { size, size };
+    BufferObject *buffer = new_buffer(2, shape);
+
+    if (buffer)
+        std::memcpy(buffer->data, conv2d_kernel_data(kernel), (size_t) size * size * sizeof(float));
+
+    conv2d_kernel_free(kernel);
+
+    return buffer ? as_array(buffer) : nullptr;
+}
+
+static PyObject* py_conv2d_channels(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "image", "kernel", "engine", "stride", "out", nullptr };
+
+    PyObject *image_obj, *kernel_obj;
+    PyObject *engine_obj = nullptr;
+    PyObject *out_obj    = Py_None;
+    int stride = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OiO", (char **) keywords,
+                                     &image_obj, &kernel_obj, &engine_obj, &stride, &out_obj))
+        return nullptr;
+
+    int engine = engine_obj ? parse_engine(engine_obj) : CONV2D_ENGINE_AVX;
+    if (PyErr_Occurred())
+        return nullptr;
+
+    conv2d_kernel *kernel;
+    if (get_kernel_buffer(kernel_obj, &kernel) != 0)
+        return nullptr;
+
+    PyObject *result = nullptr;
+    BufferObject *buffer = nullptr;
+
+    Py_buffer in_view, out_view;
+    bool has_out = false;
+
+    conv2d_image input, output;
+    int out_height, out_width, res;
+
+    if (get_image(image_obj, PyBUF_SIMPLE, in_view, input) != 0)
+        goto _exit_kernel;
+
+    res = conv2d_output_shape(&input, kernel, stride, &out_height, &out_width);
+    if (res != CONV2D_OK) {
+        raise_error(res);
+        goto _exit;
+    }
+
+    if (out_obj != Py_None) {
+        if (get_image(out_obj, PyBUF_WRITABLE, out_view, output) != 0)
+            goto _exit;
+        has_out = true;
+
+        if (output.height != out_height || output.width != out_width || output.channels != input.channels) {
+            PyErr_Format(PyExc_ValueError, "out must have shape (%d, %d, %d) or (%d, %d) for one channel",
+                         input.channels, out_height, out_width, out_height, out_width);
+            goto _exit;
+        }
+
+        // The engines read input rows after writing output rows
+        if (images_overlap(input, output)) {
+            PyErr_SetString(PyExc_ValueError, "out must not overlap image");
+            goto _exit;
+        }
+    } else {
+        Py_ssize_t shape[3] = { input.channels, out_height, out_width };
+        int ndim = in_view.ndim;
+
+        buffer = new_buffer(ndim, ndim == 3 ? shape : shape + 1);
+        if (!buffer)
+            goto _exit;
+
+        output = { buffer->data, out_height, out_width, input.channels, 0, 0 };
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    res = conv2d_convolve(engine, &input, kernel, stride, &output);
+    Py_END_ALLOW_THREADS
+
+    if (res != CONV2D_OK) {
+        raise_error(res);
+        Py_XDECREF(buffer);
+        goto _exit;
+    }
+
+    if (buffer) {
+        result = as_array(buffer);
+    } else {
+        Py_INCREF(out_obj);
+        result = out_obj;
+    }
+
+_exit:
+    if (has_out)
+        PyBuffer_Release(&out_view);
+    PyBuffer_Release(&in_view);
+
+_exit_kernel:
+    conv2d_kernel_free(kernel);
+    return result;
+}
+
+static PyObject* py_resize(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "image", "height", "width", "engine", "out", nullptr };
+
+    PyObject *image_obj;
+    PyObject *engine_obj = nullptr;
+    PyObject *out_obj    = Py_None;
+    int height, width;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oii|OO", (char **) keywords,
+                                     &image_obj, &height, &width, &engine_obj, &out_obj))
+        return nullptr;
+
+    int engine = engine_obj ? parse_engine(engine_obj) : CONV2D_ENGINE_AVX;
+    if (PyErr_Occurred())
+        return nullptr;
+
+    if (height <= 0 || width <= 0) {
+        PyErr_SetString(PyExc_ValueError, "height and width must be positive");
+        return nullptr;
+    }
+
+    PyObject *result = nullptr;
+    BufferObject *buffer = nullptr;
+
+    Py_buffer in_view, out_view;
+    bool has_out = false;
+
+    conv2d_image input, output;
+    int res;
+
+    if (get_image(image_obj, PyBUF_SIMPLE, in_view, input) != 0)
+        return nullptr;
+
+    if (out_obj != Py_None) {
+        if (get_image(out_obj, PyBUF_WRITABLE, out_view, output) != 0)
+            goto _exit;
+        has_out = true;
+
+        if (output.height != height || output.width != width || output.channels != input.channels) {
+            PyErr_Format(PyExc_ValueError, "out must have shape (%d, %d, %d) or (%d, %d) for one channel",
+                         input.channels, height, width, height, width);
+            goto _exit;
+        }
+
+        // The engines read input rows after writing output rows
+        if (images_overlap(input, output)) {
+            PyErr_SetString(PyExc_ValueError, "out must not overlap image");
+            goto _exit;
+        }
+    } else {
+        Py_ssize_t shape[3] = { input.channels, height, width };
+        int ndim = in_view.ndim;
+
+        buffer = new_buffer(ndim, ndim == 3 ? shape : shape + 1);
+        if (!buffer)
+            goto _exit;
+
+        output = { buffer->data, height, width, input.channels, 0, 0 };
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    res = conv2d_resize(engine, &input, &output);
+    Py_END_ALLOW_THREADS
+
+    if (res != CONV2D_OK) {
+        raise_error(res);
+        Py_XDECREF(buffer);
+        goto _exit;
+    }
+
+    if (buffer) {
+        result = as_array(buffer);
+    } else {
+        Py_INCREF(out_obj);
+        result = out_obj;
+    }
+
+_exit:
+    if (has_out)
+        PyBuffer_Release(&out_view);
+    PyBuffer_Release(&in_view);
+
+    return result;
+}
+
+static void model_destructor(PyObject *capsule) {
+    conv2d_model_free((conv2d_model *) PyCapsule_GetPointer(capsule, MODEL_CAPSULE_NAME));
+}
+
+static PyObject* py_load_model(PyObject *, PyObject *args) {
+    const char *kernel_path, *fc_weight_path, *fc_bias_path;
+
+    if (!PyArg_ParseTuple(args, "sss", &kernel_path, &fc_weight_path, &fc_bias_path))
+        return nullptr;
+
+    conv2d_model *model;
+    int res;
+
+    Py_BEGIN_ALLOW_THREADS
+    res = conv2d_model_load(kernel_path, fc_weight_path, fc_bias_path, &model);
+    Py_END_ALLOW_THREADS
+
+    if (res != CONV2D_OK)
+        return raise_error(res);
+
+    PyObject *capsule = PyCapsule_New(model, MODEL_CAPSULE_NAME, model_destructor);
+    if (!capsule)
+        conv2d_model_free(model);
+
+    return capsule;
+}
+
+static PyObject* py_infer(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "model", "image", "engine", nullptr };
+
+    PyObject *model_obj, *image_obj;
+    PyObject *engine_obj = nullptr;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O", (char **) keywords,
+                                     &model_obj, &image_obj, &engine_obj))
+        return nullptr;
+
+    conv2d_model *model = (conv2d_model *) PyCapsule_GetPointer(model_obj, MODEL_CAPSULE_NAME);
+    if (!model)
+        return nullptr;
+
+    int engine = engine_obj ? parse_engine(engine_obj) : CONV2D_ENGINE_AVX;
+    if (PyErr_Occurred())
+        return nullptr;
+
+    Py_buffer view;
+    conv2d_image image;
+    if (get_image(image_obj, PyBUF_SIMPLE, view, image) != 0)
+        return nullptr;
+
+    int predicted_class = 0;
+    int res;
+
+    Py_BEGIN_ALLOW_THREADS
+    res = conv2d_infer(engine, model, &image, &predicted_class);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (res != CONV2D_OK)
+        return raise_error(res);
+
+    return PyLong_FromLong(predicted_class);
+}
+
+static PyObject* py_api_version(PyObject *, PyObject *) {
+    int version = conv2d_api_version();
+    return Py_BuildValue("(iii)", version >> 16, (version >> 8) & 0xff, version & 0xff);
+}
+
+static PyMethodDef conv2d_methods[] = {
+    { "get_kernel", py_get_kernel, METH_VARARGS,
+      "get_kernel(kernel_type, size) -> (size, size) float32 array" },
+    { "conv2d_channels", (PyCFunction) (void (*)(void)) py_conv2d_channels, METH_VARARGS | METH_KEYWORDS,
+      "conv2d_channels(image, kernel, engine='avx', stride=1, out=None) -> array\n\n"
+      "image is (H, W) or planar (C, H, W) float32; each channel is convolved\n"
+      "with the (k, k) kernel (valid padding). The result is written into out\n"
+      "when given, otherwise into a new array." },
+    { "resize", (PyCFunction) (void (*)(void)) py_resize, METH_VARARGS | METH_KEYWORDS,
+      "resize(image, height, width, engine='avx', out=None) -> array\n\n"
+      "Bilinear resize (PIL pixel-centre mapping) of an (H, W) or planar\n"
+      "(C, H, W) float32 image, e.g. to the model's (64, 64) input." },
+    { "load_model", py_load_model, METH_VARARGS,
+      "load_model(kernel_path, fc_weight_path, fc_bias_path) -> model" },
+    { "infer", (PyCFunction) (void (*)(void)) py_infer, METH_VARARGS | METH_KEYWORDS,
+      "infer(model, image, engine='avx') -> predicted class for a (64, 64) float32 image" },
+    { "api_version", py_api_version, METH_NOARGS,
+      "api_version() -> (major, minor, patch) of the linked libconv2d" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyModuleDef conv2d_module = {
+    PyModuleDef_HEAD_INIT,
+    "conv2d",
+    "SIMD 2-D convolution engines and CNN inference (libconv2d).",
+    -1,
+    conv2d_methods,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr
+};
+
+PyMODINIT_FUNC PyInit_conv2d(void) {
+    BufferType = (PyTypeObject *) PyType_FromSpec(&buffer_spec);
+    if (!BufferType)
+        return nullptr;
+
+    return PyModule_Create(&conv2d_module);
+}
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "autotune.h"
+#include "constants.h"
+#include "tensor.h"
+#include "utility.h"
+
+typedef std::tuple<int, int, int, int, int, int, int> TuneMapKey;
+
+static TuneMapKey map_key(const TuneKey& key) {
+    return std::make_tuple(
+        key.height, key.width, key.channels,
+        key.kernel_size, key.kernel_type, key.stride, key.dtype);
+}
+
+struct TuneCache {
+    std::mutex mutex;
+    std::string path = TUNE_CACHE_PATH_DEF;
+    bool loaded = false;
+    std::map<TuneMapKey, TuneConfig> entries;
+};
+
+// Leaked like the kernel registry: lookups may run from static destructors
+static TuneCache& get_tune_cache() {
+    static TuneCache *cache = new TuneCache();
+    return *cache;
+}
+
+TuneKey tune_key(const Conv2DParams& params) {
+    TuneKey key;
+    key.height      = params.image.height;
+    key.width       = params.image.width;
+    key.channels    = params.image.channels;
+    key.kernel_size = params.kernel.size;
+    key.kernel_type = params.kernel.type;
+    key.stride      = params.stride;
+    key.dtype       = params.image.dtype;
+    return key;
+}
+
+// ==========================================================================
+// ============================= Cache File =================================
+// ==========================================================================
+
+// Only configurations conv2d_channels_tiled() runs as tuned
+static bool is_valid_config(const TuneKey& key, const TuneConfig& config) {
+    bool concrete =
+        config.engine_mode == ENGINE_MODE_BASELINE ||
+        config.engine_mode == ENGINE_MODE_SSE      ||
+        config.engine_mode == ENGINE_MODE_AVX;
+
+    return (
+        concrete &&
+        conv2d_engine_supports(config.engine_mode, key.kernel_size) &&
+        config.tile_rows >= 0 &&
+        config.threads >= 1
+    );
+}
+
+// One shape per line after the header:
+//   height width channels kernel_size kernel_type stride dtype engine tile threads ms
+static void load_cache_file(TuneCache& cache) {
+    cache.loaded = true;
+
+    std::ifstream file(cache.path);
+    if (!file)
+        return;
+
+    std::string line;
+
+    // Older layouts are dropped and their shapes re-tuned
+    if (!std::getline(file, line) || line != TUNE_CACHE_HEADER) {
+        print_warn("Ignoring tuning cache written by another version");
+        return;
+    }
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream in(line);
+        TuneKey key;
+        TuneConfig config;
+
+        if (!(in >> key.height >> key.width >> key.channels >> key.kernel_size >> key.kernel_type >> key.stride
+                 >> key.dtype >> config.engine_mode >> config.tile_rows >> config.threads >> config.ms)) {
+            print_warn("Skipping malformed tuning cache line");
+            continue;
+        }
+
+        // Hand-edited or stale entries are dropped, so their shapes re-tune
+        if (!is_valid_config(key, config)) {
+            print_warn("Skipping invalid tuning cache entry");
+            continue;
+        }
+
+        cache.entries[map_key(key)] = config;
+    }
+}
+
+// Written to a temporary file and renamed, so readers never see half a cache
+static int save_cache_file(const TuneCache& cache) {
+    std::string tmp_path = cache.path + ".tmp";
+
+    FILE *out = fopen(tmp_path.c_str(), "w");
+    if (!out) {
+        print_err("Failed to write tuning cache", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    fprintf(out, "%s\n", TUNE_CACHE_HEADER);
+    fprintf(out, "# height width channels kernel_size kernel_type stride dtype engine tile_rows threads ms\n");
+
+    for (const auto& entry : cache.entries) {
+        const TuneMapKey& k = entry.first;
+        const TuneConfig& c = entry.second;
+
+        fprintf(out, "%d %d %d %d %d %d %d %d %d %d %.6f\n",
+                std::get<0>(k), std::get<1>(k), std::get<2>(k),
+                std::get<3>(k), std::get<4>(k), std::get<5>(k), std::get<6>(k),
+                c.engine_mode, c.tile_rows, c.threads, c.ms);
+    }
+
+    if (fclose(out) != 0 || std::rename(tmp_path.c_str(), cache.path.c_str()) != 0) {
+        print_err("Failed to write tuning cache", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    return CODE_SUCCESS;
+}
+
+void autotune_set_cache_path(const std::string& path) {
+    TuneCache& cache = get_tune_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    cache.path   = path;
+    cache.loaded = false;
+    cache.entries.clear();
+}
+
+// ==========================================================================
+// =============================== Tuning ===================================
+// ==========================================================================
+
+static int time_config(
+    const Conv2DParams& params,
+    const Image& output,
+    TuneConfig& config
+) {
+    std::vector<double> samples;
+
+    for (int run = 0; run < TUNE_WARMUP + TUNE_REPS; run++) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        int res = conv2d_channels_tiled(
+                config.engine_mode,
+                params,
+                output,
+                config.tile_rows,
+                config.threads);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        if (res != CODE_SUCCESS)
+            return res;
+
+        if (run >= TUNE_WARMUP)
+            samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    config.ms = samples[samples.size() / 2];
+
+    return CODE_SUCCESS;
+}
+
+// Times each candidate and keeps the fastest in best
+static int pick_fastest(
+    const Conv2DParams& params,
+    const Image& output,
+    const std::vector<TuneConfig>& candidates,
+    TuneConfig& best,
+    FILE *report
+) {
+    for (TuneConfig candidate : candidates) {
+        int res = time_config(params, output, candidate);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        if (report)
+            fprintf(report, "  %-8s tile %4d  threads %2d  %10.4f ms\n",
+                    get_engine_name(candidate.engine_mode).c_str(),
+                    candidate.tile_rows, candidate.threads, candidate.ms);
+
+        if (best.ms == 0.0 || candidate.ms < best.ms)
+            best = candidate;
+    }
+
+    return CODE_SUCCESS;
+}
+
+int autotune_shape(const Conv2DParams& params, TuneConfig& best, FILE *report) {
+
+    int res;
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    if (out_height <= 0 || out_width <= 0 || params.image.channels <= 0) {
+        print_err("Cannot tune a shape smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Scratch data of the same geometry and dtype; only the timing matters
+    Tensor input(params.image.height, params.image.width, params.image.channels);
+    Tensor output(out_height, out_width, params.image.channels, params.image.dtype);
+
+    size_t count = (size_t) params.image.height * params.image.width * params.image.channels;
+    for (size_t i = 0; i < count; i++)
+        input.data()[i] = (float) (i % 251) / 251.0f;
+
+    res = input.convert_to(params.image.dtype);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    Conv2DParams scratch = params;
+    scratch.image = input.view();
+
+    std::vector<TuneConfig> candidates;
+    TuneConfig stage;
+
+    // 1. Engine, single-threaded and untiled
+    const int engines[] = { ENGINE_MODE_BASELINE, ENGINE_MODE_SSE, ENGINE_MODE_AVX };
+    for (int engine_mode : engines) {
+        if (!conv2d_engine_supports(engine_mode, params.kernel.size))
+            continue;
+
+        TuneConfig c;
+        c.engine_mode = engine_mode;
+        candidates.push_back(c);
+    }
+
+    res = pick_fastest(scratch, output.view(), candidates, stage, report);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    // 2. Band height for the winning engine
+    const int tiles[] = { 16, 64, 256 };
+    candidates.clear();
+    for (int tile_rows : tiles) {
+        if (tile_rows >= out_height)
+            continue;
+
+        TuneConfig c = stage;
+        c.tile_rows = tile_rows;
+        candidates.push_back(c);
+    }
+
+    res = pick_fastest(scratch, output.view(), candidates, stage, report);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    // 3. Thread count, doubling up to the hardware
+    int hardware = std::min((int) std::thread::hardware_concurrency(), TUNE_MAX_THREADS);
+    candidates.clear();
+    for (int threads = 2; threads <= hardware && threads <= out_height; threads *= 2) {
+        TuneConfig c = stage;
+        c.threads = threads;
+        candidates.push_back(c);
+    }
+
+    res = pick_fastest(scratch, output.view(), candidates, stage, report);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    best = stage;
+    return CODE_SUCCESS;
+}
+
+// ==========================================================================
+// ================================ Cache ===================================
+// ==========================================================================
+
+int autotune_store(const TuneKey& key, const TuneConfig& config) {
+    TuneCache& cache = get_tune_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    if (!cache.loaded)
+        load_cache_file(cache);
+
+    cache.entries[map_key(key)] = config;
+
+    return save_cache_file(cache);
+}
+
+int autotune_lookup(const Conv2DParams& params, TuneConfig& config) {
+    TuneCache& cache = get_tune_cache();
+    TuneKey key = tune_key(params);
+
+    // Held while tuning, so a shape is benchmarked once and the timings are
+    // not disturbed by other tuning runs
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    if (!cache.loaded)
+        load_cache_file(cache);
+
+    auto it = cache.entries.find(map_key(key));
+    if (it != cache.entries.end()) {
+        config = it->second;
+        return CODE_SUCCESS;
+    }
+
+    int res = autotune_shape(params, config);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    cache.entries[map_key(key)] = config;
+
+    // A read-only cache location only costs re-tuning in the next process
+    if (save_cache_file(cache) != CODE_SUCCESS)
+        print_warn("Tuning result kept in memory only");
+
+    return CODE_SUCCESS;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sched.h>
+
+#include "benchmark.h"
+#include "constants.h"
+#include "utility.h"
+
+double percentile(
+    const std::vector<double>& sorted,
+    double p
+) {
+    if (sorted.empty())
+        return 0.0;
+
+    // Linear interpolation between closest ranks
+    double rank = p / 100.0 * (sorted.size() - 1);
+    size_t lo   = static_cast<size_t>(std::floor(rank));
+    size_t hi   = std::min(lo + 1, sorted.size() - 1);
+    double frac = rank - lo;
+
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * frac;
+}
+
+int compute_benchmark_stats(
+    const std::vector<double>& samples_ms,
+    BenchmarkStats& stats
+) {
+    if (samples_ms.empty())
+        return CODE_FAILURE_INVALID_ARG;
+
+    std::vector<double> sorted = samples_ms;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double v : sorted)
+        sum += v;
+
+    stats.samples = static_cast<int>(sorted.size());
+    stats.min     = sorted.front();
+    stats.max     = sorted.back();
+    stats.mean    = sum / sorted.size();
+    stats.median  = percentile(sorted, 50.0);
+    stats.p95     = percentile(sorted, 95.0);
+    stats.p99     = percentile(sorted, 99.0);
+
+    double sq = 0.0;
+    for (double v : sorted)
+        sq += (v - stats.mean) * (v - stats.mean);
+
+    stats.stddev = sorted.size() > 1 ? std::sqrt(sq / (sorted.size() - 1)) : 0.0;
+    stats.cv     = stats.mean > 0.0 ? stats.stddev / stats.mean : 0.0;
+
+    return CODE_SUCCESS;
+}
+
+int pin_to_cpu(int cpu) {
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        print_warn("Failed to pin benchmark to the requested CPU, running unpinned");
+        return CODE_FAILURE;
+    }
+
+    return CODE_SUCCESS;
+}
+
+int parse_report_format(const std::string& name) {
+    if (name == "text")
+        return REPORT_FORMAT_TEXT;
+    if (name == "json")
+        return REPORT_FORMAT_JSON;
+    if (name == "csv")
+        return REPORT_FORMAT_CSV;
+
+    return REPORT_FORMAT_NONE;
+}
+
+// Throughput is reported against the median repetition, which is robust to
+// the occasional preempted run.
+static double megapixels_per_sec(const BenchmarkReport& report) {
+    return report.stats.median > 0.0
+        ? report.megapixels / (report.stats.median / 1000.0)
+        : 0.0;
+}
+
+static double gflops(const BenchmarkReport& report) {
+    return report.stats.median > 0.0
+        ? report.gflop / (report.stats.median / 1000.0)
+        : 0.0;
+}
+
+static void write_text(FILE *out, const BenchmarkReport& report) {
+    const BenchmarkStats& s = report.stats;
+
+    fprintf(out, "Engine:     %s\n", get_engine_name(report.engine_mode).c_str());
+    fprintf(out, "Kernel:     %s %dx%d\n",
+            get_kernel_type_name(report.kernel_type).c_str(), report.kernel_size, report.kernel_size);
+    fprintf(out, "Images:     %d (%s, %s)\n", report.images,
+            get_color_mode_name(report.color_mode).c_str(), get_dtype_name(report.dtype).c_str());
+    fprintf(out, "Threads:    %d\n", report.threads);
+    fprintf(out, "Runs:       %d (+%d warm-up)\n", s.samples, report.warmup);
+    fprintf(out, "Time (ms):  min %.3lf | median %.3lf | mean %.3lf | p95 %.3lf | p99 %.3lf | max %.3lf\n",
+            s.min, s.median, s.mean, s.p95, s.p99, s.max);
+    fprintf(out, "Spread:     stddev %.3lf ms | cv %.2lf%%\n", s.stddev, s.cv * 100.0);
+    fprintf(out, "Throughput: %.2lf MP/s | %.2lf GFLOP/s\n", megapixels_per_sec(report), gflops(report));
+}
+
+static void write_json(FILE *out, const BenchmarkReport& report) {
+    const BenchmarkStats& s = report.stats;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"engine\": \"%s\",\n", get_engine_name(report.engine_mode).c_str());
+    fprintf(out, "  \"kernel_type\": \"%s\",\n", get_kernel_type_name(report.kernel_type).c_str());
+    fprintf(out, "  \"kernel_size\": %d,\n", report.kernel_size);
+    fprintf(out, "  \"color_mode\": \"%s\",\n", get_color_mode_name(report.color_mode).c_str());
+    fprintf(out, "  \"dtype\": \"%s\",\n", get_dtype_name(report.dtype).c_str());
+    fprintf(out, "  \"threads\": %d,\n", report.threads);
+    fprintf(out, "  \"images\": %d,\n", report.images);
+    fprintf(out, "  \"warmup\": %d,\n", report.warmup);
+    fprintf(out, "  \"repetitions\": %d,\n", s.samples);
+    fprintf(out, "  \"min_ms\": %.6lf,\n", s.min);
+    fprintf(out, "  \"median_ms\": %.6lf,\n", s.median);
+    fprintf(out, "  \"mean_ms\": %.6lf,\n", s.mean);
+    fprintf(out, "  \"p95_ms\": %.6lf,\n", s.p95);
+    fprintf(out, "  \"p99_ms\": %.6lf,\n", s.p99);
+    fprintf(out, "  \"max_ms\": %.6lf,\n", s.max);
+    fprintf(out, "  \"stddev_ms\": %.6lf,\n", s.stddev);
+    fprintf(out, "  \"cv\": %.6lf,\n", s.cv);
+    fprintf(out, "  \"megapixels_per_sec\": %.6lf,\n", megapixels_per_sec(report));
+    fprintf(out, "  \"gflops\": %.6lf\n", gflops(report));
+    fprintf(out, "}\n");
+}
+
+static void write_csv(FILE *out, const BenchmarkReport& report) {
+    const BenchmarkStats& s = report.stats;
+
+    fprintf(out, "engine,kernel_type,kernel_size,color_mode,dtype,threads,images,warmup,repetitions,"
+                 "min_ms,median_ms,mean_ms,p95_ms,p99_ms,max_ms,stddev_ms,cv,"
+                 "megapixels_per_sec,gflops\n");
+    fprintf(out, "%s,%s,%d,%s,%s,%d,%d,%d,%d,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf\n",
+            get_engine_name(report.engine_mode).c_str(),
+            get_kernel_type_name(report.kernel_type).c_str(),
+            report.kernel_size,
+            get_color_mode_name(report.color_mode).c_str(),
+            get_dtype_name(report.dtype).c_str(),
+            report.threads,
+            report.images, report.warmup, s.samples,
+            s.min, s.median, s.mean, s.p95, s.p99, s.max, s.stddev, s.cv,
+            megapixels_per_sec(report), gflops(report));
+}
+
+int write_benchmark_report(
+    const BenchmarkReport& report,
+    int report_format,
+    const std::string& report_path
+) {
+    FILE *out = stdout;
+
+    if (!report_path.empty()) {
+        out = fopen(report_path.c_str(), "w");
+        if (!out) {
+            print_err("Failed to open benchmark report file", CODE_FAILURE_WRITE_OUTPUT);
+            return CODE_FAILURE_WRITE_OUTPUT;
+        }
+    }
+
+    switch (report_format) {
+        case REPORT_FORMAT_JSON: write_json(out, report); break;
+        case REPORT_FORMAT_CSV:  write_csv(out, report);  break;
+        default:                 write_text(out, report); break;
+    }
+
+    if (out != stdout)
+        fclose(out);
+
+    return CODE_SUCCESS;
+}
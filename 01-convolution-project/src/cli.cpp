@@ -1,11 +1,41 @@
 #include <iostream> 
 #include <getopt.h>
+#include <cstdio>
 #include <cstdlib>
 
+#include "benchmark.h"
 #include "cli.h"
 #include "constants.h"
 #include "utility.h"
 
+// Long-only options use values outside the char range
+enum {
+    OPT_WARMUP = 256,
+    OPT_REPS,
+    OPT_CPU,
+    OPT_FORMAT,
+    OPT_REPORT,
+    OPT_PERF,
+    OPT_PIPELINE,
+    OPT_DECODERS,
+    OPT_WORKERS,
+    OPT_ENCODERS,
+    OPT_QUEUE,
+    OPT_SOCKET,
+    OPT_REQUESTS,
+    OPT_CLIENTS,
+    OPT_FRAME,
+    OPT_SHM,
+    OPT_SLOTS,
+    OPT_SIZE,
+    OPT_PYRAMID,
+    OPT_LEVELS,
+    OPT_BANK,
+    OPT_TRACE,
+    OPT_TUNE_CACHE,
+    OPT_DTYPE,
+};
+
 static struct option long_options[] = {
     {"mode",      required_argument, nullptr, 'm'},
     {"engine",    required_argument, nullptr, 'e'},
@@ -18,6 +48,30 @@ static struct option long_options[] = {
     {"output",    required_argument, nullptr, 'o'},
     {"color",     required_argument, nullptr, 'c'},
     {"eval",     no_argument,       nullptr, 'v'},
+    {"warmup",    required_argument, nullptr, OPT_WARMUP},
+    {"reps",      required_argument, nullptr, OPT_REPS},
+    {"cpu",       required_argument, nullptr, OPT_CPU},
+    {"format",    required_argument, nullptr, OPT_FORMAT},
+    {"report",    required_argument, nullptr, OPT_REPORT},
+    {"perf",      no_argument,       nullptr, OPT_PERF},
+    {"pipeline",  no_argument,       nullptr, OPT_PIPELINE},
+    {"decoders",  required_argument, nullptr, OPT_DECODERS},
+    {"workers",   required_argument, nullptr, OPT_WORKERS},
+    {"encoders",  required_argument, nullptr, OPT_ENCODERS},
+    {"queue",     required_argument, nullptr, OPT_QUEUE},
+    {"socket",    required_argument, nullptr, OPT_SOCKET},
+    {"requests",  required_argument, nullptr, OPT_REQUESTS},
+    {"clients",   required_argument, nullptr, OPT_CLIENTS},
+    {"frame",     required_argument, nullptr, OPT_FRAME},
+    {"shm",       no_argument,       nullptr, OPT_SHM},
+    {"slots",     required_argument, nullptr, OPT_SLOTS},
+    {"size",      required_argument, nullptr, OPT_SIZE},
+    {"pyramid",   required_argument, nullptr, OPT_PYRAMID},
+    {"levels",    required_argument, nullptr, OPT_LEVELS},
+    {"bank",      required_argument, nullptr, OPT_BANK},
+    {"trace",     required_argument, nullptr, OPT_TRACE},
+    {"tune-cache", required_argument, nullptr, OPT_TUNE_CACHE},
+    {"dtype",     required_argument, nullptr, OPT_DTYPE},
     {"help",     no_argument,       nullptr, 'h'},
     {nullptr,    0,                 nullptr, 0}
 };
@@ -26,18 +80,79 @@ void print_help() {
     std::cout <<
     "Usage: conv2d [OPTIONS]\n\n"
     "Modes:\n"
-    "  -m --mode functional | speed | infer\n\n"
+    "  -m --mode functional | speed | infer | roofline | serve | loadgen | stream |\n"
+    "            pyramid | tune\n\n"
     "Options:\n"
-    "  -e, --engine     baseline | sse | avx\n"
-    "  -k, --ktype      kernel type (functional/speed only)\n"
-    "  -s, --ksize      kernel size (functional/speed only)\n"
+    "  -e, --engine     baseline | sse | avx | auto (roofline: optional filter)\n"
+    "                   auto runs the tuned engine/tile/threads for each shape,\n"
+    "                   tuning shapes missing from the cache on first use\n"
+    "  -k, --ktype      kernel type (functional/speed; pyramid: optional filter)\n"
+    "  -s, --ksize      kernel size (functional/speed; roofline: optional filter)\n"
     "  -p, --kpath      path to conv kernel file (infer mode)\n"
     "  -w, --fc_weight  path to fully connected weight file (infer mode)\n"
     "  -b, --fc_bias    path to fully connected bias file (infer mode)\n"
-    "  -i, --input      input file or directory\n"
-    "  -o, --output     output file (optional)\n"
+    "  -i, --input      input file or directory (stream: video file or - for stdin)\n"
+    "  -o, --output     output file (optional; stream: video file or - for stdout)\n"
     "  -c, --color      grayscale | rgb (default = rgb)\n"
+    "      --dtype      f32 | f64 | f16 | bf16 image storage for the engines\n"
+    "                   (functional/speed/tune; default = f32)\n"
     "  -v, --eval       evaluate model\n"
+    "      --trace FILE record decode/conv/relu/flatten/linear/encode stages and write a\n"
+    "                   Chrome trace JSON (open in Perfetto or chrome://tracing)\n"
+    "\n"
+    "Benchmark (speed mode, not with --pipeline):\n"
+    "      --warmup N   untimed warm-up passes over the input directory (default = 0)\n"
+    "      --reps N     timed passes; reports min/median/p95/p99/cv (default = 1)\n"
+    "      --cpu N      pin the benchmark to CPU N; every thread inherits the pin,\n"
+    "                   so it needs --workers 1 and a fixed engine\n"
+    "      --format     text | json | csv (default = text)\n"
+    "      --report     write the benchmark report to a file instead of stdout\n"
+    "      --perf       read hardware counters (cycles, IPC, cache/branch misses) around\n"
+    "                   each engine call (functional/speed; speed needs --workers 1)\n"
+    "\n"
+    "Workers (speed / serve modes):\n"
+    "      --workers N  worker threads (default = 1); per mode they are:\n"
+    "                   speed: threads sharing the batch of images (small images\n"
+    "                   are interleaved, large ones split into bands)\n"
+    "                   speed --pipeline: convolution stage threads\n"
+    "                   serve: connections handled concurrently\n"
+    "\n"
+    "Pipeline (speed mode):\n"
+    "      --pipeline   overlap decode, convolution and encode with bounded queues\n"
+    "      --decoders N decoder threads; without --pipeline they load the input\n"
+    "                   directory in parallel (default = 1)\n"
+    "      --encoders N encoder threads (default = 1)\n"
+    "      --queue N    capacity of each queue between stages (default = 8)\n"
+    "\n"
+    "Service (serve / loadgen modes):\n"
+    "      --socket     Unix socket path (default = " SERVE_SOCKET_PATH_DEF ")\n"
+    "      --queue N    serve: accepted connections waiting for a worker; further\n"
+    "                   connections are refused while it is full\n"
+    "      --requests N loadgen: total requests (default = 1000)\n"
+    "      --clients N  loadgen: concurrent connections (default = 1)\n"
+    "      --frame N    loadgen: side of the synthetic frame sent when no\n"
+    "                   --input image is given (default = 512)\n"
+    "      --shm        loadgen: pass synthetic frames through a shared-memory\n"
+    "                   ring; only slot descriptors cross the socket\n"
+    "      --slots N    loadgen: ring slots, used as input/output pairs (default = 4)\n"
+    "\n"
+    "Stream mode:\n"
+    "      --size WxH   frame size of raw 8-bit frames on stdin (grey, or bgr24 with\n"
+    "                   -c rgb); raw output uses the same pixel format\n"
+    "\n"
+    "Pyramid mode:\n"
+    "      --pyramid    gaussian | laplacian (default = gaussian)\n"
+    "      --levels N   number of levels including the input (default = 4)\n"
+    "      --bank LIST  filters run on every level, e.g. sobel_x,sobel_y:3,gaussian_blur:5\n"
+    "                   (size defaults to 3); -k/-s add one more filter\n"
+    "                   Files are written as <output stem>_l<level>[_<filter>]<ext>\n"
+    "\n"
+    "Tune mode (-k, -s and -c select the kernel and channels):\n"
+    "      --size WxH   shape to tune, unless -i gives an image to take it from\n"
+    "      --tune-cache FILE\n"
+    "                   tuning cache read by -e auto and written by tune mode\n"
+    "                   (default = " TUNE_CACHE_PATH_DEF ")\n"
+    "\n"
     "  -h, --help       show this help\n";
 }
 
@@ -48,6 +163,18 @@ static int get_run_mode_by_name(const std::string& run_mode_name) {
         return RUN_MODE_SPEED_TEST;
     if (run_mode_name == "infer")
         return RUN_MODE_INFER_TEST;
+    if (run_mode_name == "roofline")
+        return RUN_MODE_ROOFLINE;
+    if (run_mode_name == "serve")
+        return RUN_MODE_SERVE;
+    if (run_mode_name == "loadgen")
+        return RUN_MODE_LOADGEN;
+    if (run_mode_name == "stream")
+        return RUN_MODE_STREAM;
+    if (run_mode_name == "pyramid")
+        return RUN_MODE_PYRAMID;
+    if (run_mode_name == "tune")
+        return RUN_MODE_TUNE;
 
     return RUN_MODE_NONE;
 }
@@ -59,6 +186,8 @@ static int get_engine_mode_by_name(const std::string& engine_mode_name) {
         return ENGINE_MODE_SSE;
     if (engine_mode_name == "avx")
         return ENGINE_MODE_AVX;
+    if (engine_mode_name == "auto")
+        return ENGINE_MODE_AUTO;
 
     return ENGINE_MODE_NONE;
 }
@@ -78,6 +207,46 @@ static int get_kernel_type_by_name(const std::string& kernel_type_name) {
     return KERNEL_TYPE_NONE;
 }
 
+static int get_pyramid_type_by_name(const std::string& pyramid_type_name) {
+    if (pyramid_type_name == "gaussian")
+        return PYRAMID_TYPE_GAUSSIAN;
+    if (pyramid_type_name == "laplacian")
+        return PYRAMID_TYPE_LAPLACIAN;
+
+    return PYRAMID_TYPE_NONE;
+}
+
+// Comma-separated type[:size] entries; names become file name suffixes
+static int parse_filter_bank(const std::string& list, std::vector<FilterSpec>& bank) {
+    size_t start = 0;
+
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+
+        std::string entry = list.substr(start, end - start);
+        size_t colon = entry.find(':');
+
+        FilterSpec spec;
+        spec.kernel_type = get_kernel_type_by_name(entry.substr(0, colon));
+        spec.kernel_size = KERNEL_SIZE_3;
+
+        if (colon != std::string::npos && safe_atoi(entry.c_str() + colon + 1, &spec.kernel_size) != CODE_SUCCESS)
+            return CODE_FAILURE_INVALID_ARG;
+
+        if (spec.kernel_type == KERNEL_TYPE_NONE || spec.kernel_size <= 0)
+            return CODE_FAILURE_INVALID_ARG;
+
+        spec.name = entry.substr(0, colon) + std::to_string(spec.kernel_size);
+        bank.push_back(spec);
+
+        start = end + 1;
+    }
+
+    return CODE_SUCCESS;
+}
+
 static int get_color_mode_by_name(const std::string& color_mode_name) {
     if (color_mode_name == "grayscale")
         return COLOR_MODE_GRAYSCALE;
@@ -87,6 +256,19 @@ static int get_color_mode_by_name(const std::string& color_mode_name) {
     return COLOR_MODE_NONE;
 }
 
+static int get_dtype_by_name(const std::string& dtype_name) {
+    if (dtype_name == "f32")
+        return DTYPE_F32;
+    if (dtype_name == "f64")
+        return DTYPE_F64;
+    if (dtype_name == "f16")
+        return DTYPE_F16;
+    if (dtype_name == "bf16")
+        return DTYPE_BF16;
+
+    return DTYPE_NONE;
+}
+
 int parse_cli(int argc, char **argv, CLIArgs& args) {
     
     int opt; 
@@ -109,6 +291,7 @@ int parse_cli(int argc, char **argv, CLIArgs& args) {
             
             case 'k':
                 args.kernel_type = get_kernel_type_by_name(optarg);
+                args.kernel_name = optarg;
                 break;
 
             case 'p':
@@ -147,6 +330,104 @@ int parse_cli(int argc, char **argv, CLIArgs& args) {
             case 'h':
                 args.help = true;
                 break;
+
+            case OPT_WARMUP:
+                args.warmup = std::atoi(optarg);
+                break;
+
+            case OPT_REPS:
+                args.repetitions = std::atoi(optarg);
+                break;
+
+            case OPT_CPU:
+                args.cpu = std::atoi(optarg);
+                break;
+
+            case OPT_FORMAT:
+                args.report_format = parse_report_format(optarg);
+                break;
+
+            case OPT_REPORT:
+                args.report_path = optarg;
+                break;
+
+            case OPT_PERF:
+                args.perf_counters = true;
+                break;
+
+            case OPT_PIPELINE:
+                args.pipeline = true;
+                break;
+
+            case OPT_DECODERS:
+                args.decode_threads = std::atoi(optarg);
+                break;
+
+            case OPT_WORKERS:
+                args.conv_threads = std::atoi(optarg);
+                break;
+
+            case OPT_ENCODERS:
+                args.encode_threads = std::atoi(optarg);
+                break;
+
+            case OPT_QUEUE:
+                args.queue_depth = std::atoi(optarg);
+                break;
+
+            case OPT_SOCKET:
+                args.socket_path = optarg;
+                break;
+
+            case OPT_REQUESTS:
+                args.requests = std::atoi(optarg);
+                break;
+
+            case OPT_CLIENTS:
+                args.clients = std::atoi(optarg);
+                break;
+
+            case OPT_FRAME:
+                args.frame_size = std::atoi(optarg);
+                break;
+
+            case OPT_SHM:
+                args.shm = true;
+                break;
+
+            case OPT_SLOTS:
+                args.slots = std::atoi(optarg);
+                break;
+
+            case OPT_SIZE:
+                if (sscanf(optarg, "%dx%d", &args.frame_width, &args.frame_height) != 2)
+                    return CODE_FAILURE_INVALID_ARG;
+                break;
+
+            case OPT_PYRAMID:
+                args.pyramid_type = get_pyramid_type_by_name(optarg);
+                break;
+
+            case OPT_LEVELS:
+                args.levels = std::atoi(optarg);
+                break;
+
+            case OPT_DTYPE:
+                args.dtype = get_dtype_by_name(optarg);
+                break;
+
+            case OPT_TUNE_CACHE:
+                args.tune_cache = optarg;
+                break;
+
+            case OPT_TRACE:
+                args.trace_path = optarg;
+                break;
+
+            case OPT_BANK:
+                if (parse_filter_bank(optarg, args.bank) != CODE_SUCCESS)
+                    return CODE_FAILURE_INVALID_ARG;
+                break;
             
             default: 
                 return CODE_FAILURE_INVALID_ARG;
@@ -163,11 +444,112 @@ int validate_cli(CLIArgs& args) {
         return CODE_FAILURE_INVALID_ARG;
     }
 
+    if (args.dtype == DTYPE_NONE) {
+        print_err("Invalid dtype", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Other modes feed the engines from f32 decoders, models or sockets
+    if (
+        args.dtype != DTYPE_F32 &&
+        args.run_mode != RUN_MODE_FUNCTIONAL_TEST &&
+        args.run_mode != RUN_MODE_SPEED_TEST &&
+        args.run_mode != RUN_MODE_TUNE
+    ) {
+        print_err("--dtype is only supported in functional, speed and tune modes", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Roofline measures the machine itself; engine and kernel size only filter
+    if (args.run_mode == RUN_MODE_ROOFLINE) {
+        if (args.engine_mode == ENGINE_MODE_AUTO) {
+            print_err("Roofline measures fixed engines; auto is not allowed", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+        return CODE_VALIDATION_OK;
+    }
+
+    // The server takes engine and kernel from each request
+    if (args.run_mode == RUN_MODE_SERVE) {
+        if (args.conv_threads < 1 || args.queue_depth < 1) {
+            print_err("Worker count and queue depth must be positive", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+        // Workers inherit the pinned mask and would all share that CPU
+        if (args.cpu >= 0 && args.conv_threads > 1) {
+            print_err("--cpu needs a single worker (--workers 1)", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+        return CODE_VALIDATION_OK;
+    }
+
+    // Tune mode picks the engine itself
+    if (args.run_mode == RUN_MODE_TUNE) {
+        if (args.kernel_type == KERNEL_TYPE_NONE || args.kernel_size <= 0) {
+            print_err("Invalid kernel type or size", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+
+        if (args.color_mode == COLOR_MODE_NONE)
+            args.color_mode = COLOR_MODE_GRAYSCALE;
+
+        return CODE_VALIDATION_OK;
+    }
+
     if (args.engine_mode == ENGINE_MODE_NONE) {
         print_err("Invalid engine mode", CODE_FAILURE_INVALID_ARG);
         return CODE_FAILURE_INVALID_ARG;  
     }
 
+    // Auto runs the tuned thread count, and every thread would inherit the
+    // pinned mask
+    if (
+        args.cpu >= 0 && args.engine_mode == ENGINE_MODE_AUTO &&
+        (args.run_mode == RUN_MODE_SPEED_TEST || args.run_mode == RUN_MODE_STREAM)
+    ) {
+        print_err("--cpu needs a fixed engine; auto may run several threads", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Pyramid levels and server requests run on fixed engines; only the
+    // conv2d entry points consult the tuning cache
+    if (args.engine_mode == ENGINE_MODE_AUTO &&
+        (args.run_mode == RUN_MODE_PYRAMID || args.run_mode == RUN_MODE_LOADGEN)) {
+        print_err("Engine auto is not supported in this mode", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // The filter bank is optional in pyramid mode; -k/-s add to it when given
+    if (args.run_mode == RUN_MODE_PYRAMID) {
+        if (args.pyramid_type == PYRAMID_TYPE_NONE) {
+            print_err("Invalid pyramid type", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+
+        if (args.levels < 1 || args.levels > PYRAMID_MAX_LEVELS) {
+            print_err("Invalid pyramid level count", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+
+        if (args.input.empty()) {
+            print_err("Input is required", CODE_FAILURE_ARG_REQUIRED);
+            return CODE_FAILURE_ARG_REQUIRED;
+        }
+
+        if (args.kernel_type != KERNEL_TYPE_NONE) {
+            FilterSpec spec;
+            spec.kernel_type = args.kernel_type;
+            spec.kernel_size = args.kernel_size > 0 ? args.kernel_size : KERNEL_SIZE_3;
+            spec.name        = args.kernel_name + std::to_string(spec.kernel_size);
+            args.bank.push_back(spec);
+        }
+
+        if (args.color_mode == COLOR_MODE_NONE)
+            args.color_mode = COLOR_MODE_GRAYSCALE;
+
+        return CODE_VALIDATION_OK;
+    }
+
     if (args.run_mode != RUN_MODE_INFER_TEST && args.kernel_type == KERNEL_TYPE_NONE) {
         print_err("Invalid kernel type", CODE_FAILURE_INVALID_ARG);
         return CODE_FAILURE_INVALID_ARG;
@@ -178,6 +560,20 @@ int validate_cli(CLIArgs& args) {
         return CODE_FAILURE_INVALID_ARG;  
     }
 
+    if (args.run_mode == RUN_MODE_LOADGEN) {
+        if (args.requests < 1 || args.clients < 1 || args.frame_size < args.kernel_size) {
+            print_err("Invalid request count, client count or frame size", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+        if (args.shm && (args.slots < 2 || args.slots % 2 != 0)) {
+            print_err("Shared memory ring needs an even number of slots", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+        if (args.color_mode == COLOR_MODE_NONE)
+            args.color_mode = COLOR_MODE_GRAYSCALE;
+        return CODE_VALIDATION_OK;
+    }
+
     if (args.input.empty()) {
         print_err("Input is required", CODE_FAILURE_ARG_REQUIRED);
         return CODE_FAILURE_ARG_REQUIRED; 
@@ -188,6 +584,47 @@ int validate_cli(CLIArgs& args) {
         args.save_output = false;
     }
 
+    if (args.report_format == REPORT_FORMAT_NONE) {
+        print_err("Invalid report format", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (args.warmup < 0 || args.repetitions < 1) {
+        print_err("Invalid warm-up or repetition count", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (
+        args.decode_threads < 1 || args.conv_threads < 1 || 
+        args.encode_threads < 1 || args.queue_depth < 1
+    ) {
+        print_err("Pipeline thread counts and queue depth must be positive", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // The pipeline reports its own wall time; it has no repetitions, pinning,
+    // counters or report file
+    if (
+        args.run_mode == RUN_MODE_SPEED_TEST && args.pipeline &&
+        (args.perf_counters || args.cpu >= 0 || args.warmup != 0 || args.repetitions != 1 ||
+         args.report_format != REPORT_FORMAT_TEXT || !args.report_path.empty())
+    ) {
+        print_err("--perf, --cpu, --warmup, --reps, --format and --report are not supported with --pipeline", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Batch workers inherit the pinned mask and would all share that CPU
+    if (args.run_mode == RUN_MODE_SPEED_TEST && args.cpu >= 0 && args.conv_threads > 1) {
+        print_err("--cpu needs a single worker (--workers 1)", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Counters follow the calling thread only, while bytes cover the batch
+    if (args.run_mode == RUN_MODE_SPEED_TEST && args.perf_counters && args.conv_threads > 1) {
+        print_err("--perf needs a single worker (--workers 1)", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
     if (args.color_mode == COLOR_MODE_NONE) {
         print_warn("will set color mode to RGB");
         args.color_mode = COLOR_MODE_RGB;
@@ -1,20 +1,31 @@
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include <filesystem>
+#include <opencv2/opencv.hpp>
 
 #include "cnn_inference.h"
 #include "infer_test.h"
 #include "constants.h"
+#include "tensor.h"
 #include "io.h"
 #include "conv2d.h"
+#include "resize.h"
+#include "trace.h"
 #include "utility.h"
 
 static inline void relu(Image& img) {
-    int total = img.height * img.width * img.channels;
-    for (int i = 0; i < total; i++) {
-        if (img.data[i] < 0.0f) {
-            img.data[i] = 0.0f;
+    TRACE_SCOPE("relu");
+
+    for (int c = 0; c < img.channels; c++) {
+        for (int y = 0; y < img.height; y++) {
+            float *row = img.data + c * image_channel_stride(img) + y * image_row_stride(img);
+            for (int x = 0; x < img.width; x++) {
+                if (row[x] < 0.0f) {
+                    row[x] = 0.0f;
+                }
+            }
         }
     }
 }
@@ -27,6 +38,8 @@ static inline void linear(
     int in_features, 
     int out_features
 ) {
+    TRACE_SCOPE("linear");
+
     for (int o = 0; o < out_features; o++) {
         float sum = bias[o];
 
@@ -39,14 +52,33 @@ static inline void linear(
 }
 
 static inline float* flatten(const Image& img) {
+    TRACE_SCOPE("flatten");
+
     int total = img.height * img.width * img.channels;
-    float* flat = new float[total];
-    
-    std::memcpy(flat, img.data, total * sizeof(float));
+    float* flat = tensor_alloc(total);
+    float* dst  = flat;
+
+    for (int c = 0; c < img.channels; c++) {
+        for (int y = 0; y < img.height; y++) {
+            const float *row = img.data + c * image_channel_stride(img) + y * image_row_stride(img);
+            std::memcpy(dst, row, img.width * sizeof(float));
+            dst += img.width;
+        }
+    }
 
     return flat;
 }
 
+void free_model(CNNModel& model) {
+    tensor_free(model.fc_weight);
+    tensor_free(model.fc_bias);
+    tensor_free(model.kernel.data);
+
+    model.fc_weight   = nullptr;
+    model.fc_bias     = nullptr;
+    model.kernel.data = nullptr;
+}
+
 int load_model(
     const InferTestParams& params,
     CNNModel& model
@@ -56,12 +88,8 @@ int load_model(
     res = load_kernel_from_file(params.kernel_path.c_str(), model.kernel);
     if (res != CODE_SUCCESS) return res;
 
-    // Compute conv output size using dummy image size
-    int img_h = 64;
-    int img_w = 64;
-
-    int conv_out_h = img_h - model.kernel.size + 1;
-    int conv_out_w = img_w - model.kernel.size + 1;
+    int conv_out_h = model.in_height - model.kernel.size + 1;
+    int conv_out_w = model.in_width  - model.kernel.size + 1;
 
     model.in_features = conv_out_h * conv_out_w;
 
@@ -82,7 +110,7 @@ int load_model(
     return CODE_SUCCESS;
 }
 
-int choose_class(
+static int choose_class(
     int engine_mode,
     const Conv2DParams& conv2d_params, 
     const float* fc_weight,
@@ -110,33 +138,33 @@ int choose_class(
 
     predicted_class = (output[1] > output[0]) ? 1 : 0;
 
-    delete[] flat;
-    delete[] conv_out.data;
+    tensor_free(flat);
+    tensor_free(conv_out.data);
 
     return CODE_SUCCESS;
 }
 
-int infer_single(
-    const std::string& image_path,
+int infer_image(
     int engine_mode,
+    const Image& image,
     const CNNModel& model,
     int& predicted_class
 ) {
-    int res;
-
-    Image img;
-    res = load_tensor(image_path, img);
-    if (res != CODE_SUCCESS) {
-        print_err("Failed to load tensor", res);
-        return res;
-    }
-
     Conv2DParams params;
-    params.image  = img;
+    params.image  = image;
     params.kernel = model.kernel;
     params.stride = 1;
 
-    res = choose_class(
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    // The FC layer reads exactly in_features values
+    if (image.channels != 1 || out_height * out_width != model.in_features) {
+        print_err("Image does not match the model input size", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    int res = choose_class(
         engine_mode,
         params,
         model.fc_weight,
@@ -146,12 +174,186 @@ int infer_single(
         predicted_class
     );
 
-    if (res != CODE_SUCCESS) {
+    if (res != CODE_SUCCESS)
         print_err("Failed to choose class", res);
+
+    return res;
+}
+
+// ==========================================================================
+// ========================= Fused Preprocessing ============================
+// ==========================================================================
+
+// One model-input row: horizontal taps from two source rows, vertical blend,
+// then the ToTensor scale. Same weights as resize_channels_into(); scaling
+// after interpolation instead of before only moves the last bit.
+static void resize_gray8_row(
+    const uint8_t *top,
+    const uint8_t *bottom,
+    float wy,
+    const ResizeAxis& xs,
+    float *dst,
+    int width
+) {
+    for (int x = 0; x < width; x++) {
+        const int x0 = xs.i0[x];
+        const int x1 = xs.i1[x];
+        const float wx = xs.w[x];
+
+        float t = top[x0]    + wx * (float) (top[x1]    - top[x0]);
+        float b = bottom[x0] + wx * (float) (bottom[x1] - bottom[x0]);
+
+        dst[x] = (t + wy * (b - t)) * CNN_PIXEL_SCALE;
+    }
+}
+
+int infer_gray8(
+    int engine_mode,
+    const uint8_t *pixels,
+    int height,
+    int width,
+    size_t stride,
+    const CNNModel& model,
+    int& predicted_class
+) {
+    TRACE_SCOPE("infer gray8");
+
+    const int k      = model.kernel.size;
+    const int in_h   = model.in_height;
+    const int in_w   = model.in_width;
+    const int conv_w = in_w - k + 1;
+
+    if (!pixels || height <= 0 || width <= 0 || stride < (size_t) width) {
+        print_err("Invalid source image", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (
+        k <= 0 || k > in_h || k > in_w ||
+        (in_h - k + 1) * conv_w != model.in_features ||
+        model.out_features != 2
+    ) {
+        print_err("Model does not match its input size", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Decide once instead of letting every row fall back with a warning
+    if (!conv2d_engine_supports(engine_mode, k))
+        engine_mode = ENGINE_MODE_BASELINE;
+
+    ResizeAxis xs, ys;
+    build_resize_axis(width, in_w, xs);
+    build_resize_axis(height, in_h, ys);
+
+    // Mirrored ring: input row y is written to slots y % k and y % k + k, so
+    // the k rows ending at y are always contiguous starting at (y + 1) % k.
+    Tensor ring(2 * k, in_w, 1);
+    Tensor conv_row(1, conv_w, 1);
+
+    Conv2DParams params;
+    params.image.height   = k;
+    params.image.width    = in_w;
+    params.image.channels = 1;
+    params.kernel         = model.kernel;
+    params.stride         = 1;
+
+    float sums[2] = { model.fc_bias[0], model.fc_bias[1] };
+
+    for (int y = 0; y < in_h; y++) {
+        float *slot = ring.data() + (size_t) (y % k) * in_w;
+
+        resize_gray8_row(
+            pixels + (size_t) ys.i0[y] * stride,
+            pixels + (size_t) ys.i1[y] * stride,
+            ys.w[y], xs, slot, in_w);
+
+        std::memcpy(slot + (size_t) k * in_w, slot, in_w * sizeof(float));
+
+        if (y < k - 1)
+            continue;
+
+        const int out_y = y - k + 1;
+        params.image.data = ring.data() + (size_t) (out_y % k) * in_w;
+
+        int res = conv2d_channels_into(engine_mode, params, conv_row.view());
+        if (res != CODE_SUCCESS) {
+            print_err("Failed to run conv2d_channels_into", res);
+            return res;
+        }
+
+        // ReLU + FC, accumulated in the same order as linear() over the
+        // flattened conv output
+        const float *row = conv_row.data();
+        for (int o = 0; o < 2; o++) {
+            const float *w = model.fc_weight + (size_t) o * model.in_features + (size_t) out_y * conv_w;
+            float sum = sums[o];
+
+            for (int x = 0; x < conv_w; x++)
+                sum += std::max(row[x], 0.0f) * w[x];
+
+            sums[o] = sum;
+        }
+    }
+
+    predicted_class = (sums[1] > sums[0]) ? 1 : 0;
+
+    return CODE_SUCCESS;
+}
+
+int infer_image_file(
+    const std::string& image_path,
+    int engine_mode,
+    const CNNModel& model,
+    int& predicted_class
+) {
+    cv::Mat gray;
+    {
+        TRACE_SCOPE("decode");
+        gray = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+    }
+
+    if (gray.empty()) {
+        std::string err_msg = "Failed to decode image: " + image_path;
+        print_err(err_msg.c_str(), CODE_FAILURE_READ_INPUT);
+        return CODE_FAILURE_READ_INPUT;
+    }
+
+    return infer_gray8(
+        engine_mode,
+        gray.ptr<uint8_t>(0), gray.rows, gray.cols, gray.step,
+        model,
+        predicted_class);
+}
+
+// Lowercased, so selection in evaluate_dataset() and dispatch in
+// infer_single() agree on files like FOO.BIN
+static std::string lower_extension(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+int infer_single(
+    const std::string& image_path,
+    int engine_mode,
+    const CNNModel& model,
+    int& predicted_class
+) {
+    int res;
+
+    if (lower_extension(image_path) != CNN_TENSOR_EXT)
+        return infer_image_file(image_path, engine_mode, model, predicted_class);
+
+    Image img;
+    res = load_tensor(image_path, img);
+    if (res != CODE_SUCCESS) {
+        print_err("Failed to load tensor", res);
         return res;
     }
-    
-    delete[] img.data;
+
+    res = infer_image(engine_mode, img, model, predicted_class);
+
+    tensor_free(img.data);
 
     return res;
 }
@@ -179,7 +381,15 @@ int evaluate_dataset(
 
         for (const auto& file : std::filesystem::directory_iterator(class_dir.path())) {
 
-            if (file.path().extension() != ".bin")
+            if (!file.is_regular_file())
+                continue;
+
+            std::string ext = lower_extension(file.path());
+
+            if (
+                ext != CNN_TENSOR_EXT && ext != ".png" && 
+                ext != ".jpg" && ext != ".jpeg" && ext != ".bmp"
+            )
                 continue;
 
             int predicted;
@@ -1,30 +1,90 @@
-#include <cstring>
 #include <immintrin.h>
-#include <string>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 #include "conv2d.h"
+#include "autotune.h"
+#include "builtin_kernels.h"
 #include "constants.h"
+#include "dtype.h"
+#include "tensor.h"
+#include "trace.h"
 #include "utility.h"
 
 static int conv2d(
     int engine_mode, 
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 );
 
 static int conv2d_baseline(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 );
 
 static int conv2d_sse(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 );
 
 static int conv2d_avx(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
+);
+
+static int conv2d_sse_folded(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+);
+
+static int conv2d_avx_folded(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+);
+
+static bool is_builtin_3x3(const Kernel& kernel);
+
+static int check_output(
+    const Conv2DParams& params,
+    const Image& output,
+    Conv2DStatus& status
+);
+
+static int conv2d_planes(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    Conv2DStatus& status
+);
+
+// f64, f16 and bf16 images; f32 ones take the engines above
+static int conv2d_storage(
+    int engine_mode, 
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+);
+
+static int conv2d_sse_builtin(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+);
+
+static int conv2d_avx_builtin(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
 );
 
 static bool is_valid_engine_mode(int engine_mode) {
@@ -46,10 +106,21 @@ static bool is_valid_kernel(const Kernel& kernel) {
     return true;
 }
 
+static bool is_valid_dtype(int dtype) {
+    return (
+        dtype == DTYPE_F32 ||
+        dtype == DTYPE_F64 ||
+        dtype == DTYPE_F16 ||
+        dtype == DTYPE_BF16
+    );
+}
+
 static bool is_valid_image(const Image& image ) {
     if (
         !image.data ||
-        !(image.height > 0 && image.width > 0)
+        !(image.height > 0 && image.width > 0) ||
+        image_row_stride(image) < image.width ||
+        !is_valid_dtype(image.dtype)
     ) {
         return false;
     }
@@ -91,12 +162,86 @@ static int conv2d_validation(
     return CODE_VALIDATION_OK;
 }
 
+// Aligned variants are only legal when the row base is aligned and the row
+// length keeps every vector step on the same alignment.
+static inline __m128 load_sse(const float *ptr, bool aligned) {
+    return aligned ? _mm_load_ps(ptr) : _mm_loadu_ps(ptr);
+}
+
+static inline void store_sse(float *ptr, __m128 value, bool aligned) {
+    if (aligned) _mm_store_ps(ptr, value);
+    else         _mm_storeu_ps(ptr, value);
+}
+
+static inline __m256 load_avx(const float *ptr, bool aligned) {
+    return aligned ? _mm256_load_ps(ptr) : _mm256_loadu_ps(ptr);
+}
+
+static inline void store_avx(float *ptr, __m256 value, bool aligned) {
+    if (aligned) _mm256_store_ps(ptr, value);
+    else         _mm256_storeu_ps(ptr, value);
+}
+
+// Registry kernels carry every tap pre-broadcast; plain kernels are splatted.
+static inline __m128 tap_sse(const Kernel& kernel, int i) {
+    return kernel.taps 
+        ? _mm_load_ps(kernel.taps + i * KERNEL_TAP_LANES) 
+        : _mm_set1_ps(kernel.data[i]);
+}
+
+static inline __m256 tap_avx(const Kernel& kernel, int i) {
+    return kernel.taps 
+        ? _mm256_load_ps(kernel.taps + i * KERNEL_TAP_LANES) 
+        : _mm256_set1_ps(kernel.data[i]);
+}
+
 static float* channel_ptr(const Image& img, int c) {
 
     if (c >= img.channels) 
         return nullptr;
 
-    return img.data + c * img.height * img.width;
+    return image_element(img, c * image_channel_stride(img));
+}
+
+// Auto only ever picks engines that take the kernel
+bool conv2d_engine_supports(int engine_mode, int kernel_size) {
+    return (
+        engine_mode == ENGINE_MODE_BASELINE || 
+        engine_mode == ENGINE_MODE_AUTO     || 
+        kernel_size == KERNEL_SIZE_3
+    );
+}
+
+void conv2d_output_size(
+    const Conv2DParams& params,
+    int& out_height,
+    int& out_width
+) {
+    if (params.stride < 1) {
+        out_height = out_width = 0;
+        return;
+    }
+
+    out_height = (params.image.height - params.kernel.size) / params.stride + 1;
+    out_width  = (params.image.width - params.kernel.size) / params.stride + 1;
+}
+
+Image image_roi(
+    const Image& image,
+    int y,
+    int x,
+    int height,
+    int width
+) {
+    Image roi = image;
+
+    roi.data           = image_element(image, (size_t) y * image_row_stride(image) + x);
+    roi.height         = height;
+    roi.width          = width;
+    roi.row_stride     = image_row_stride(image);
+    roi.channel_stride = (int) image_channel_stride(image);
+
+    return roi;
 }
 
 int conv2d_channels(
@@ -107,84 +252,479 @@ int conv2d_channels(
 
     int res = CODE_SUCCESS;
 
+    if (!is_valid_stride(params.stride)) {
+        print_err("Invalid stride", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    conv2d_output_size(params, output.height, output.width);
+
+    if (output.height <= 0 || output.width <= 0) {
+        print_err("Image is smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    output.channels       = params.image.channels;
+    output.row_stride     = 0;
+    output.channel_stride = 0;
+    output.dtype          = params.image.dtype;
+    output.data           = tensor_alloc(dtype_storage_floats(
+                                output.dtype, (size_t) output.height * output.width * output.channels));
+
+    res = conv2d_channels_into(
+            engine_mode,
+            params,
+            output);
+
+    if (res != CODE_SUCCESS) {
+        tensor_free(output.data);
+        output.data = nullptr;
+    }
+
+    return res;
+}
+
+// Logging wrapper over the reentrant entry point for single-threaded callers
+int conv2d_channels_into(
+    int engine_mode, 
+    const Conv2DParams& params, 
+    const Image& output
+) {
+
+    int res = CODE_SUCCESS;
+
+    if (engine_mode == ENGINE_MODE_AUTO) {
+        TuneConfig config;
+
+        // Tuning benchmarks these parameters, so they are checked first
+        if (!is_valid_conv2d_params(params)) {
+            print_err("Invalid arguments to function", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+
+        res = autotune_lookup(params, config);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        return conv2d_channels_tiled(
+                config.engine_mode,
+                params,
+                output,
+                config.tile_rows,
+                config.threads);
+    }
+
+    TRACE_SCOPE("conv");
+
+    Conv2DStatus status;
+
+    size_t workspace_floats = conv2d_workspace_size(engine_mode, params);
+    float *workspace = workspace_floats ? tensor_alloc(workspace_floats) : nullptr;
+
+    res = conv2d_channels_ws(
+            engine_mode,
+            params,
+            output,
+            workspace,
+            workspace_floats,
+            status);
+
+    tensor_free(workspace);
+
     // TODO: Temporary 
+    if (status.fallback)
+        print_warn("Only 3x3 kernels are supported in SSE/AVX engines. Falling back to baseline engine.");
+
+    if (res != CODE_SUCCESS)
+        print_err(status.message, res);
+
+    return res;
+}
+
+// Band b covers output rows [b * band_rows, ...) and reads the input rows
+// those outputs need; bands are handed out through an atomic counter.
+int conv2d_channels_tiled(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    int tile_rows,
+    int threads
+) {
+    if (!is_valid_stride(params.stride)) {
+        print_err("Invalid stride", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    if (out_height <= 0 || out_width <= 0 || threads < 1 || tile_rows < 0) {
+        print_err("Invalid tiling or image smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    threads = std::min(threads, out_height);
+
+    const int band_rows = tile_rows > 0
+        ? std::min(tile_rows, out_height)
+        : (out_height + threads - 1) / threads;
+    const int bands = (out_height + band_rows - 1) / band_rows;
+
+    threads = std::min(threads, bands);
+
+    std::atomic<int> next_band(0);
+    std::vector<Conv2DStatus> statuses(threads);
+
+    auto worker = [&](int t) {
+        Conv2DStatus& status = statuses[t];
+
+        size_t workspace_floats = conv2d_workspace_size(engine_mode, params);
+        float *workspace = workspace_floats ? tensor_alloc(workspace_floats) : nullptr;
+
+        int b;
+        while ((b = next_band++) < bands) {
+            TRACE_SCOPE("conv");
+
+            const int y0   = b * band_rows;
+            const int rows = std::min(band_rows, out_height - y0);
+
+            Conv2DParams band = params;
+            band.image = image_roi(
+                    params.image, 
+                    y0 * params.stride, 0, 
+                    (rows - 1) * params.stride + params.kernel.size, 
+                    params.image.width);
+
+            Image band_out = image_roi(output, y0, 0, rows, out_width);
+
+            if (conv2d_channels_ws(engine_mode, band, band_out, workspace, workspace_floats, status) != CODE_SUCCESS) {
+                next_band = bands;
+                break;
+            }
+        }
+
+        tensor_free(workspace);
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(worker, t);
+
+    worker(0);
+
+    for (auto& thread : pool)
+        thread.join();
+
+    for (const Conv2DStatus& status : statuses) {
+        if (status.fallback) {
+            print_warn("Only 3x3 kernels are supported in SSE/AVX engines. Falling back to baseline engine.");
+            break;
+        }
+    }
+
+    for (const Conv2DStatus& status : statuses) {
+        if (status.code != CODE_SUCCESS) {
+            print_err(status.message, status.code);
+            return status.code;
+        }
+    }
+
+    return CODE_SUCCESS;
+}
+
+static int set_status(Conv2DStatus& status, int code, const char *msg) {
+    status.code = code;
+    snprintf(status.message, sizeof(status.message), "%s", msg);
+    return code;
+}
+
+// None of the current engines needs scratch: every output row is produced
+// straight from the input rows it reads.
+size_t conv2d_workspace_size(
+    int engine_mode,
+    const Conv2DParams& params
+) {
+    (void) engine_mode;
+    (void) params;
+
+    return 0;
+}
+
+int conv2d_channels_ws(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    float *workspace,
+    size_t workspace_floats,
+    Conv2DStatus& status
+) {
+
+    int res = CODE_SUCCESS;
+
+    status.code        = CODE_SUCCESS;
+    status.engine_mode = engine_mode;
+    status.fallback    = false;
+    status.message[0]  = '\0';
+
+    if (conv2d_validation(engine_mode, params) != CODE_VALIDATION_OK)
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Invalid arguments to function");
+
+    if (!conv2d_engine_supports(engine_mode, params.kernel.size)) {
+        engine_mode        = ENGINE_MODE_BASELINE;
+        status.engine_mode = engine_mode;
+        status.fallback    = true;
+    }
+
+    if (workspace_floats < conv2d_workspace_size(engine_mode, params) || (workspace_floats && !workspace))
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Workspace is smaller than conv2d_workspace_size()");
+
+    res = check_output(params, output, status);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    return conv2d_planes(engine_mode, params, output, status);
+}
+
+static int check_output(
+    const Conv2DParams& params,
+    const Image& output,
+    Conv2DStatus& status
+) {
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    if (out_height <= 0 || out_width <= 0)
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Image is smaller than the kernel");
+
     if (
-        params.kernel.size != KERNEL_SIZE_3 && 
-        engine_mode != ENGINE_MODE_BASELINE
+        !output.data || 
+        output.height < out_height || output.width < out_width ||
+        output.channels < params.image.channels
     ) {
-        engine_mode = ENGINE_MODE_BASELINE;
-        print_warn("Only 3x3 kernels are supported in SSE/AVX engines. Falling back to baseline engine.");
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Output view is too small for the result");
     }
 
-    Image image   = params.image;
-    Kernel kernel = params.kernel;
+    // Rows and planes must not overlap or run before output.data
+    if (
+        image_row_stride(output) < out_width || output.channel_stride < 0 ||
+        (params.image.channels > 1 &&
+         image_channel_stride(output) < (size_t) out_height * image_row_stride(output))
+    ) {
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Output strides overlap rows or channels");
+    }
 
-    int out_height = (image.height - kernel.size) / params.stride + 1;
-    int out_width  = (image.width - kernel.size) / params.stride + 1;
-    
-    output.height   = out_height;
-    output.width    = out_width;
-    output.channels = image.channels;
-    output.data     = new float[output.height * output.width * output.channels];
+    if (output.dtype != params.image.dtype)
+        return set_status(status, CODE_FAILURE_INVALID_ARG, "Output dtype differs from the input dtype");
+
+    return CODE_SUCCESS;
+}
 
-    for (int c = 0; c < output.channels; c++) {
+// Arguments were validated and the engine resolved by the caller
+static int conv2d_planes(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    Conv2DStatus& status
+) {
+    for (int c = 0; c < params.image.channels; c++) {
         Conv2DParams ch_params = params;
-        ch_params.image.data = channel_ptr(image, c);
+        ch_params.image.data = channel_ptr(params.image, c);
+
+        int res = conv2d(
+                engine_mode, 
+                ch_params, 
+                channel_ptr(output, c), 
+                image_row_stride(output));
+
+        if (res != CODE_SUCCESS) {
+            status.code = res;
+            snprintf(status.message, sizeof(status.message), "Operation failed on channel %d", c);
+            return res;
+        }
+    }
+
+    return CODE_SUCCESS;
+}
+
+// ==========================================================================
+// ================================ Batch ===================================
+// ==========================================================================
+
+// Output rows [y0, y0 + rows) of image index
+struct BatchItem {
+    size_t index;
+    int    y0;
+    int    rows;
+    int    engine_mode;     // resolved per image: AUTO and fallback applied
+};
+
+// Small images are one item each, larger ones split into bands of about
+// BATCH_CHUNK_PIXELS, so workers interleave thumbnails instead of one thread
+// owning an image and the others waiting for it.
+int conv2d_batch(
+    int engine_mode,
+    const Kernel& kernel,
+    int stride,
+    const Image *inputs,
+    const Image *outputs,
+    size_t count,
+    int threads
+) {
+
+    TRACE_SCOPE("conv batch");
+
+    int res = CODE_SUCCESS;
+
+    if (count == 0)
+        return CODE_SUCCESS;
+
+    if (
+        !inputs || !outputs || threads < 0 || !is_valid_stride(stride) ||
+        (engine_mode != ENGINE_MODE_AUTO && !is_valid_engine_mode(engine_mode))
+    ) {
+        print_err("Invalid batch arguments", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
 
-        Image ch_out;
-        res = conv2d(engine_mode, ch_params, ch_out);
+    std::vector<BatchItem> items;
+    bool fallback = false;
 
+    Conv2DStatus status;
+
+    for (size_t i = 0; i < count; i++) {
+        Conv2DParams params = { inputs[i], kernel, stride };
+
+        if (!is_valid_conv2d_params(params)) {
+            print_err("Invalid arguments to function", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
+        }
+
+        res = check_output(params, outputs[i], status);
         if (res != CODE_SUCCESS) {
-            std::string err_msg = "Operation failed on channel " + std::to_string(c);
-            print_err(err_msg.c_str(), res);
+            print_err(status.message, res);
             return res;
         }
 
-        std::memcpy( 
-            channel_ptr(output, c),
-            ch_out.data,
-            output.height * output.width * sizeof(float)
-        );
+        // Auto takes the engine tuned for this image's shape; the batch's
+        // own banding and workers replace the tuned tile and thread count
+        int image_engine = engine_mode;
+
+        if (engine_mode == ENGINE_MODE_AUTO) {
+            TuneConfig config;
+
+            res = autotune_lookup(params, config);
+            if (res != CODE_SUCCESS)
+                return res;
+
+            image_engine = config.engine_mode;
+        }
+
+        if (!conv2d_engine_supports(image_engine, kernel.size)) {
+            image_engine = ENGINE_MODE_BASELINE;
+            fallback     = true;
+        }
+
+        int out_height, out_width;
+        conv2d_output_size(params, out_height, out_width);
 
-        delete[] ch_out.data;
+        const int band_rows = std::max(1, BATCH_CHUNK_PIXELS / out_width);
+
+        for (int y0 = 0; y0 < out_height; y0 += band_rows)
+            items.push_back({ i, y0, std::min(band_rows, out_height - y0), image_engine });
     }
 
-    return res;
+    if (fallback)
+        print_warn("Only 3x3 kernels are supported in SSE/AVX engines. Falling back to baseline engine.");
+
+    if (threads == 0)
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+
+    threads = (int) std::min((size_t) threads, items.size());
+
+    std::atomic<size_t> next_item(0);
+    std::vector<Conv2DStatus> statuses(threads);
+
+    auto worker = [&](int t) {
+        size_t n;
+        while ((n = next_item++) < items.size()) {
+            TRACE_SCOPE("conv");
+
+            const BatchItem& item = items[n];
+
+            Conv2DParams band = { inputs[item.index], kernel, stride };
+            band.image = image_roi(
+                    band.image,
+                    item.y0 * stride, 0,
+                    (item.rows - 1) * stride + kernel.size,
+                    band.image.width);
+
+            Image band_out = image_roi(
+                    outputs[item.index], 
+                    item.y0, 0, 
+                    item.rows, outputs[item.index].width);
+
+            if (conv2d_planes(item.engine_mode, band, band_out, statuses[t]) != CODE_SUCCESS) {
+                next_item = items.size();
+                break;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(worker, t);
+
+    worker(0);
+
+    for (auto& thread : pool)
+        thread.join();
+
+    for (const Conv2DStatus& worker_status : statuses) {
+        if (worker_status.code != CODE_SUCCESS) {
+            print_err(worker_status.message, worker_status.code);
+            return worker_status.code;
+        }
+    }
+
+    return CODE_SUCCESS;
 }
 
 static int conv2d(
     int engine_mode, 
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 ) {
     int res = CODE_SUCCESS;
     
-    res = conv2d_validation(
-            engine_mode,  
-            params);
-
-    if (res != CODE_VALIDATION_OK) {
-        print_err("Invalid arguments to function", res);
-        return CODE_FAILURE_INVALID_ARG;
-    }
+    // Arguments were validated by conv2d_channels_ws()
+    if (params.image.dtype != DTYPE_F32)
+        return conv2d_storage(engine_mode, params, out, out_stride);
 
     switch(engine_mode) {
         case ENGINE_MODE_BASELINE: 
             res = conv2d_baseline(
                     params, 
-                    output);
+                    out,
+                    out_stride);
             break;
         
         case ENGINE_MODE_SSE:
-            res = conv2d_sse(
-                    params, 
-                    output);
+            if (is_builtin_3x3(params.kernel))
+                res = conv2d_sse_builtin(params, out, out_stride);
+            else if (params.kernel.symmetry)
+                res = conv2d_sse_folded(params, out, out_stride);
+            else
+                res = conv2d_sse(params, out, out_stride);
             break;
     
         case ENGINE_MODE_AVX:
-            res = conv2d_avx(
-                    params, 
-                    output);
+            if (is_builtin_3x3(params.kernel))
+                res = conv2d_avx_builtin(params, out, out_stride);
+            else if (params.kernel.symmetry)
+                res = conv2d_avx_folded(params, out, out_stride);
+            else
+                res = conv2d_avx(params, out, out_stride);
             break;
             
         default: res = CODE_FAILURE;
@@ -195,7 +735,8 @@ static int conv2d(
 
 static int conv2d_baseline(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 ) {
 
     int res = CODE_SUCCESS;
@@ -205,11 +746,8 @@ static int conv2d_baseline(
 
     int out_height = (image.height - kernel.size) / params.stride + 1;
     int out_width  = (image.width - kernel.size) / params.stride + 1;
-    int out_size   = out_height * out_width;
 
-    output.height = out_height;
-    output.width  = out_width;
-    output.data   = new float[out_size];
+    const int in_stride = image_row_stride(image);
 
     for (int i = 0; i < out_height; i++) {
         for (int j = 0; j < out_width; j++) {
@@ -221,7 +759,7 @@ static int conv2d_baseline(
 
             for (int u = 0; u < kernel.size; u++) {
                 
-                int img_row = (base_i + u) * image.width;
+                int img_row = (base_i + u) * in_stride;
                 int ker_row = u * kernel.size;
 
                 for (int v = 0; v < kernel.size; v++) {
@@ -232,8 +770,7 @@ static int conv2d_baseline(
                 }
             }
 
-            int out_idx = i * out_width + j;
-            output.data[out_idx] = sum; 
+            out[i * out_stride + j] = sum; 
         }
     }
 
@@ -242,7 +779,8 @@ static int conv2d_baseline(
 
 static int conv2d_sse(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 ) {
     int res = CODE_SUCCESS;
 
@@ -251,26 +789,26 @@ static int conv2d_sse(
 
     int out_height = (image.height - kernel.size) / params.stride + 1;
     int out_width  = (image.width - kernel.size) / params.stride + 1;
-    int out_size   = out_height * out_width;
 
-    output.height = out_height;
-    output.width  = out_width;
-    output.data   = new float[out_size];
+    const int in_stride = image_row_stride(image);
 
-    __m128 k00 = _mm_set1_ps(kernel.data[0]);
-    __m128 k01 = _mm_set1_ps(kernel.data[1]);
-    __m128 k02 = _mm_set1_ps(kernel.data[2]);
+    __m128 k00 = tap_sse(kernel, 0);
+    __m128 k01 = tap_sse(kernel, 1);
+    __m128 k02 = tap_sse(kernel, 2);
 
-    __m128 k10 = _mm_set1_ps(kernel.data[3]);
-    __m128 k11 = _mm_set1_ps(kernel.data[4]);
-    __m128 k12 = _mm_set1_ps(kernel.data[5]);
+    __m128 k10 = tap_sse(kernel, 3);
+    __m128 k11 = tap_sse(kernel, 4);
+    __m128 k12 = tap_sse(kernel, 5);
 
-    __m128 k20 = _mm_set1_ps(kernel.data[6]);
-    __m128 k21 = _mm_set1_ps(kernel.data[7]);
-    __m128 k22 = _mm_set1_ps(kernel.data[8]);
+    __m128 k20 = tap_sse(kernel, 6);
+    __m128 k21 = tap_sse(kernel, 7);
+    __m128 k22 = tap_sse(kernel, 8);
 
     constexpr int SSE_FLOATS = 4;
 
+    const bool aligned_in  = is_aligned(image.data, 16)  && in_stride % SSE_FLOATS == 0;
+    const bool aligned_out = is_aligned(out, 16) && out_stride % SSE_FLOATS == 0;
+
     for (int i = 0; i < out_height; i++) {
         int base_i = i * params.stride;
 
@@ -281,33 +819,33 @@ static int conv2d_sse(
             __m128 sum = _mm_setzero_ps();
 
             // Row -1
-            __m128 r0 = _mm_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 0]);
-            __m128 r1 = _mm_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 1]);
-            __m128 r2 = _mm_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 2]);
+            __m128 r0 = load_sse(&image.data[(base_i + 0) * in_stride + base_j + 0], aligned_in);
+            __m128 r1 = _mm_loadu_ps(&image.data[(base_i + 0) * in_stride + base_j + 1]);
+            __m128 r2 = _mm_loadu_ps(&image.data[(base_i + 0) * in_stride + base_j + 2]);
 
             sum = _mm_add_ps(sum, _mm_mul_ps(r0, k00));
             sum = _mm_add_ps(sum, _mm_mul_ps(r1, k01));
             sum = _mm_add_ps(sum, _mm_mul_ps(r2, k02));
 
             // Row 1
-            r0 = _mm_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 0]);
-            r1 = _mm_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 1]);
-            r2 = _mm_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 2]);
+            r0 = load_sse(&image.data[(base_i + 1) * in_stride + base_j + 0], aligned_in);
+            r1 = _mm_loadu_ps(&image.data[(base_i + 1) * in_stride + base_j + 1]);
+            r2 = _mm_loadu_ps(&image.data[(base_i + 1) * in_stride + base_j + 2]);
 
             sum = _mm_add_ps(sum, _mm_mul_ps(r0, k10));
             sum = _mm_add_ps(sum, _mm_mul_ps(r1, k11));
             sum = _mm_add_ps(sum, _mm_mul_ps(r2, k12));
 
             // Row 2
-            r0 = _mm_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 0]);
-            r1 = _mm_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 1]);
-            r2 = _mm_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 2]);
+            r0 = load_sse(&image.data[(base_i + 2) * in_stride + base_j + 0], aligned_in);
+            r1 = _mm_loadu_ps(&image.data[(base_i + 2) * in_stride + base_j + 1]);
+            r2 = _mm_loadu_ps(&image.data[(base_i + 2) * in_stride + base_j + 2]);
 
             sum = _mm_add_ps(sum, _mm_mul_ps(r0, k20));
             sum = _mm_add_ps(sum, _mm_mul_ps(r1, k21));
             sum = _mm_add_ps(sum, _mm_mul_ps(r2, k22));
 
-            _mm_storeu_ps(&output.data[i * out_width + j], sum);
+            store_sse(&out[i * out_stride + j], sum, aligned_out);
         }
 
         for (; j < out_width; j++) {
@@ -315,10 +853,10 @@ static int conv2d_sse(
             float s = 0.f;
             for (int ky = 0; ky < 3; ky++)
                 for (int kx = 0; kx < 3; kx++)
-                    s += image.data[(base_i + ky) * image.width + (base_j + kx)] *
+                    s += image.data[(base_i + ky) * in_stride + (base_j + kx)] *
                          kernel.data[ky * 3 + kx];
 
-            output.data[i * out_width + j] = s;
+            out[i * out_stride + j] = s;
         }
     }
 
@@ -327,7 +865,8 @@ static int conv2d_sse(
 
 static int conv2d_avx(
     const Conv2DParams& params, 
-    Image& output
+    float *out,
+    int out_stride
 ) {
     int res = CODE_SUCCESS;
 
@@ -336,26 +875,26 @@ static int conv2d_avx(
 
     int out_height = (image.height - kernel.size) / params.stride + 1;
     int out_width  = (image.width - kernel.size) / params.stride + 1;
-    int out_size   = out_height * out_width;
 
-    output.height = out_height;
-    output.width  = out_width;
-    output.data   = new float[out_size];
+    const int in_stride = image_row_stride(image);
 
-    __m256 k00 = _mm256_set1_ps(kernel.data[0]);
-    __m256 k01 = _mm256_set1_ps(kernel.data[1]);
-    __m256 k02 = _mm256_set1_ps(kernel.data[2]);
+    __m256 k00 = tap_avx(kernel, 0);
+    __m256 k01 = tap_avx(kernel, 1);
+    __m256 k02 = tap_avx(kernel, 2);
 
-    __m256 k10 = _mm256_set1_ps(kernel.data[3]);
-    __m256 k11 = _mm256_set1_ps(kernel.data[4]);
-    __m256 k12 = _mm256_set1_ps(kernel.data[5]);
+    __m256 k10 = tap_avx(kernel, 3);
+    __m256 k11 = tap_avx(kernel, 4);
+    __m256 k12 = tap_avx(kernel, 5);
 
-    __m256 k20 = _mm256_set1_ps(kernel.data[6]);
-    __m256 k21 = _mm256_set1_ps(kernel.data[7]);
-    __m256 k22 = _mm256_set1_ps(kernel.data[8]);
+    __m256 k20 = tap_avx(kernel, 6);
+    __m256 k21 = tap_avx(kernel, 7);
+    __m256 k22 = tap_avx(kernel, 8);
 
     constexpr int AVX_FLOATS = 8;
 
+    const bool aligned_in  = is_aligned(image.data, 32)  && in_stride % AVX_FLOATS == 0;
+    const bool aligned_out = is_aligned(out, 32) && out_stride % AVX_FLOATS == 0;
+
     for (int i = 0; i < out_height; i++) {
         int base_i = i * params.stride;
 
@@ -366,33 +905,33 @@ static int conv2d_avx(
             __m256 sum = _mm256_setzero_ps();
 
             // Row 0
-            __m256 r0 = _mm256_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 0]);
-            __m256 r1 = _mm256_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 1]);
-            __m256 r2 = _mm256_loadu_ps(&image.data[(base_i + 0) * image.width + base_j + 2]);
+            __m256 r0 = load_avx(&image.data[(base_i + 0) * in_stride + base_j + 0], aligned_in);
+            __m256 r1 = _mm256_loadu_ps(&image.data[(base_i + 0) * in_stride + base_j + 1]);
+            __m256 r2 = _mm256_loadu_ps(&image.data[(base_i + 0) * in_stride + base_j + 2]);
 
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r0, k00));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r1, k01));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r2, k02));
 
             // Row 1
-            r0 = _mm256_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 0]);
-            r1 = _mm256_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 1]);
-            r2 = _mm256_loadu_ps(&image.data[(base_i + 1) * image.width + base_j + 2]);
+            r0 = load_avx(&image.data[(base_i + 1) * in_stride + base_j + 0], aligned_in);
+            r1 = _mm256_loadu_ps(&image.data[(base_i + 1) * in_stride + base_j + 1]);
+            r2 = _mm256_loadu_ps(&image.data[(base_i + 1) * in_stride + base_j + 2]);
 
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r0, k10));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r1, k11));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r2, k12));
 
             // Row 2
-            r0 = _mm256_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 0]);
-            r1 = _mm256_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 1]);
-            r2 = _mm256_loadu_ps(&image.data[(base_i + 2) * image.width + base_j + 2]);
+            r0 = load_avx(&image.data[(base_i + 2) * in_stride + base_j + 0], aligned_in);
+            r1 = _mm256_loadu_ps(&image.data[(base_i + 2) * in_stride + base_j + 1]);
+            r2 = _mm256_loadu_ps(&image.data[(base_i + 2) * in_stride + base_j + 2]);
 
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r0, k20));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r1, k21));
             sum = _mm256_add_ps(sum, _mm256_mul_ps(r2, k22));
 
-            _mm256_storeu_ps(&output.data[i * out_width + j], sum);
+            store_avx(&out[i * out_stride + j], sum, aligned_out);
         }
 
         for (; j < out_width; j++) {
@@ -400,12 +939,629 @@ static int conv2d_avx(
             float s = 0.f;
             for (int ky = 0; ky < 3; ky++)
                 for (int kx = 0; kx < 3; kx++)
-                    s += image.data[(base_i + ky) * image.width + (base_j + kx)] *
+                    s += image.data[(base_i + ky) * in_stride + (base_j + kx)] *
                          kernel.data[ky * 3 + kx];
 
-            output.data[i * out_width + j] = s;
+            out[i * out_stride + j] = s;
         }
     }
 
     return res;
 }
+
+// ==========================================================================
+// ========================== Symmetric Kernels =============================
+// ==========================================================================
+
+// Mirrored pixels are added (symmetric) or subtracted (antisymmetric) before
+// the multiply, so a symmetric 3x3 needs 4 multiplies and Sobel X only 2:
+// (left - right) of rows 0 + 2, and of row 1. The zero centre row/column of
+// an antisymmetric kernel is never loaded. The fold shape is a template
+// parameter; a per-tap zero test inside the loop cost more than it saved.
+enum FoldMode {
+    FOLD_NONE = 0,
+    FOLD_SYMMETRIC,
+    FOLD_ANTISYMMETRIC,
+};
+
+// Storage types: Elem is what an Image holds, Acc what sums are kept in.
+// Half-precision storage accumulates in float; f64 stays in double.
+struct F32Storage {
+    typedef float Elem;
+    typedef float Acc;
+
+    static Acc to_acc(Elem v)   { return v; }
+    static Elem from_acc(Acc v) { return v; }
+};
+
+struct F64Storage {
+    typedef double Elem;
+    typedef double Acc;
+
+    static Acc to_acc(Elem v)   { return v; }
+    static Elem from_acc(Acc v) { return v; }
+};
+
+struct F16Storage {
+    typedef uint16_t Elem;
+    typedef float Acc;
+
+    static Acc to_acc(Elem v)   { return half_to_float(v); }
+    static Elem from_acc(Acc v) { return float_to_half(v); }
+};
+
+struct Bf16Storage {
+    typedef uint16_t Elem;
+    typedef float Acc;
+
+    static Acc to_acc(Elem v)   { return bf16_to_float(v); }
+    static Elem from_acc(Acc v) { return float_to_bf16(v); }
+};
+
+// Float lanes; the f32, f16 and bf16 Ops differ only in load and store
+struct SseFloat {
+    typedef __m128 Vec;
+    static constexpr int WIDTH = 4;
+
+    static Vec zero()                 { return _mm_setzero_ps(); }
+    static Vec set1(float v)          { return _mm_set1_ps(v); }
+    static Vec add(Vec a, Vec b)      { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b)      { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b)      { return _mm_mul_ps(a, b); }
+
+    static Vec tap(const Kernel& kernel, int i)          { return tap_sse(kernel, i); }
+};
+
+struct AvxFloat {
+    typedef __m256 Vec;
+    static constexpr int WIDTH = 8;
+
+    static Vec zero()                 { return _mm256_setzero_ps(); }
+    static Vec set1(float v)          { return _mm256_set1_ps(v); }
+    static Vec add(Vec a, Vec b)      { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b)      { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b)      { return _mm256_mul_ps(a, b); }
+
+    static Vec tap(const Kernel& kernel, int i)          { return tap_avx(kernel, i); }
+};
+
+struct SseOps : SseFloat, F32Storage {
+    static Vec load(const float *p)                      { return _mm_loadu_ps(p); }
+    static void store(float *p, Vec v, bool aligned)     { store_sse(p, v, aligned); }
+};
+
+struct AvxOps : AvxFloat, F32Storage {
+    static Vec load(const float *p)                      { return _mm256_loadu_ps(p); }
+    static void store(float *p, Vec v, bool aligned)     { store_avx(p, v, aligned); }
+};
+
+// F16C widens/narrows 4 or 8 halves per instruction
+struct SseF16Ops : SseFloat, F16Storage {
+    static Vec load(const uint16_t *p) {
+        return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    static void store(uint16_t *p, Vec v, bool) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+struct AvxF16Ops : AvxFloat, F16Storage {
+    static Vec load(const uint16_t *p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    static void store(uint16_t *p, Vec v, bool) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+// bf16 widens by shifting into the upper half of each float lane and
+// narrows with round-to-nearest-even, as float_to_bf16() does
+struct SseBf16Ops : SseFloat, Bf16Storage {
+    static Vec load(const uint16_t *p) {
+        __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_castsi128_ps(_mm_slli_epi32(_mm_cvtepu16_epi32(h), 16));
+    }
+
+    static void store(uint16_t *p, Vec v, bool) {
+        __m128i bits = _mm_castps_si128(v);
+        __m128i odd  = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+
+        bits = _mm_add_epi32(bits, _mm_add_epi32(odd, _mm_set1_epi32(0x7FFF)));
+        bits = _mm_srli_epi32(bits, 16);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi32(bits, bits));
+    }
+};
+
+struct AvxBf16Ops : AvxFloat, Bf16Storage {
+    static Vec load(const uint16_t *p) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+    }
+
+    static void store(uint16_t *p, Vec v, bool) {
+        __m256i bits = _mm256_castps_si256(v);
+        __m256i odd  = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+
+        bits = _mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF)));
+        bits = _mm256_srli_epi32(bits, 16);
+
+        // packus works per 128-bit lane; gather the two low quadwords
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(bits, bits), 0xD8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+    }
+};
+
+struct SseF64Ops : F64Storage {
+    typedef __m128d Vec;
+    static constexpr int WIDTH = 2;
+
+    static Vec zero()                 { return _mm_setzero_pd(); }
+    static Vec set1(double v)         { return _mm_set1_pd(v); }
+    static Vec load(const double *p)  { return _mm_loadu_pd(p); }
+    static Vec add(Vec a, Vec b)      { return _mm_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b)      { return _mm_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b)      { return _mm_mul_pd(a, b); }
+
+    static Vec tap(const Kernel& kernel, int i)          { return _mm_set1_pd(kernel.data[i]); }
+
+    static void store(double *p, Vec v, bool aligned) {
+        if (aligned) _mm_store_pd(p, v);
+        else         _mm_storeu_pd(p, v);
+    }
+};
+
+struct AvxF64Ops : F64Storage {
+    typedef __m256d Vec;
+    static constexpr int WIDTH = 4;
+
+    static Vec zero()                 { return _mm256_setzero_pd(); }
+    static Vec set1(double v)         { return _mm256_set1_pd(v); }
+    static Vec load(const double *p)  { return _mm256_loadu_pd(p); }
+    static Vec add(Vec a, Vec b)      { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b)      { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b)      { return _mm256_mul_pd(a, b); }
+
+    static Vec tap(const Kernel& kernel, int i)          { return _mm256_set1_pd(kernel.data[i]); }
+
+    static void store(double *p, Vec v, bool aligned) {
+        if (aligned) _mm256_store_pd(p, v);
+        else         _mm256_storeu_pd(p, v);
+    }
+};
+
+static int fold_mode(int symmetry, int symmetric_bit, int antisymmetric_bit) {
+    if (symmetry & symmetric_bit)     return FOLD_SYMMETRIC;
+    if (symmetry & antisymmetric_bit) return FOLD_ANTISYMMETRIC;
+    return FOLD_NONE;
+}
+
+template <typename Ops, int FoldX, int FoldY>
+static void conv2d_folded_3x3(
+    const Conv2DParams& params, 
+    typename Ops::Elem *out,
+    int out_stride
+) {
+    typedef typename Ops::Vec Vec;
+    typedef typename Ops::Elem Elem;
+    typedef typename Ops::Acc Acc;
+
+    // Rows (columns) left after folding; the mirror takes the first one's taps
+    constexpr int ROWS = FoldY == FOLD_NONE ? 3 : (FoldY == FOLD_SYMMETRIC ? 2 : 1);
+    constexpr int COLS = FoldX == FOLD_NONE ? 3 : (FoldX == FOLD_SYMMETRIC ? 2 : 1);
+
+    Image image = params.image;
+    Kernel kernel = params.kernel;
+
+    int out_height = (image.height - kernel.size) / params.stride + 1;
+    int out_width  = (image.width - kernel.size) / params.stride + 1;
+
+    const int in_stride = image_row_stride(image);
+    const int stride    = params.stride;
+
+    const Elem *src = reinterpret_cast<const Elem*>(image.data);
+
+    Vec taps[ROWS][COLS];
+
+    for (int u = 0; u < ROWS; u++) {
+        for (int v = 0; v < COLS; v++) {
+            taps[u][v] = Ops::tap(kernel, u * 3 + v);
+        }
+    }
+
+    const bool aligned_out = is_aligned(out, Ops::WIDTH * sizeof(Elem)) && out_stride % Ops::WIDTH == 0;
+
+    for (int i = 0; i < out_height; i++) {
+        int base_i = i * stride;
+
+        int j = 0;
+        for (; j <= out_width - Ops::WIDTH; j += Ops::WIDTH) {
+            const Elem *p = &src[base_i * in_stride + j * stride];
+
+            // One accumulator per folded row keeps the add chains short
+            Vec acc[ROWS];
+
+            for (int u = 0; u < ROWS; u++) {
+                const Elem *row = p + u * in_stride;
+
+                // Column dx of row u, vertically folded with its mirror row
+                auto column = [&](int dx) {
+                    Vec x = Ops::load(row + dx);
+                    if (FoldY == FOLD_SYMMETRIC && u == 0)
+                        x = Ops::add(x, Ops::load(row + 2 * in_stride + dx));
+                    if (FoldY == FOLD_ANTISYMMETRIC)
+                        x = Ops::sub(x, Ops::load(row + 2 * in_stride + dx));
+                    return x;
+                };
+
+                for (int v = 0; v < COLS; v++) {
+                    Vec x = column(v);
+                    if (FoldX == FOLD_SYMMETRIC && v == 0)
+                        x = Ops::add(x, column(2));
+                    if (FoldX == FOLD_ANTISYMMETRIC)
+                        x = Ops::sub(x, column(2));
+
+                    x = Ops::mul(x, taps[u][v]);
+                    acc[u] = v == 0 ? x : Ops::add(acc[u], x);
+                }
+            }
+
+            Vec sum = acc[0];
+            for (int u = 1; u < ROWS; u++)
+                sum = Ops::add(sum, acc[u]);
+
+            Ops::store(&out[i * out_stride + j], sum, aligned_out);
+        }
+
+        for (; j < out_width; j++) {
+            int base_j = j * stride;
+            Acc s = 0;
+            for (int ky = 0; ky < 3; ky++)
+                for (int kx = 0; kx < 3; kx++)
+                    s += Ops::to_acc(src[(base_i + ky) * in_stride + (base_j + kx)]) *
+                         kernel.data[ky * 3 + kx];
+
+            out[i * out_stride + j] = Ops::from_acc(s);
+        }
+    }
+}
+
+template <typename Ops, int FoldX>
+static void conv2d_folded_3x3(
+    int fold_y,
+    const Conv2DParams& params, 
+    typename Ops::Elem *out,
+    int out_stride
+) {
+    switch (fold_y) {
+        case FOLD_SYMMETRIC:
+            conv2d_folded_3x3<Ops, FoldX, FOLD_SYMMETRIC>(params, out, out_stride);
+            break;
+        case FOLD_ANTISYMMETRIC:
+            conv2d_folded_3x3<Ops, FoldX, FOLD_ANTISYMMETRIC>(params, out, out_stride);
+            break;
+        default:
+            conv2d_folded_3x3<Ops, FoldX, FOLD_NONE>(params, out, out_stride);
+            break;
+    }
+}
+
+template <typename Ops>
+static int conv2d_folded(
+    const Conv2DParams& params, 
+    typename Ops::Elem *out,
+    int out_stride
+) {
+    int symmetry = params.kernel.symmetry;
+
+    int fold_x = fold_mode(symmetry, KERNEL_SYMMETRIC_H, KERNEL_ANTISYMMETRIC_H);
+    int fold_y = fold_mode(symmetry, KERNEL_SYMMETRIC_V, KERNEL_ANTISYMMETRIC_V);
+
+    switch (fold_x) {
+        case FOLD_SYMMETRIC:
+            conv2d_folded_3x3<Ops, FOLD_SYMMETRIC>(fold_y, params, out, out_stride);
+            break;
+        case FOLD_ANTISYMMETRIC:
+            conv2d_folded_3x3<Ops, FOLD_ANTISYMMETRIC>(fold_y, params, out, out_stride);
+            break;
+        default:
+            conv2d_folded_3x3<Ops, FOLD_NONE>(fold_y, params, out, out_stride);
+            break;
+    }
+
+    return CODE_SUCCESS;
+}
+
+static int conv2d_sse_folded(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    return conv2d_folded<SseOps>(params, out, out_stride);
+}
+
+static int conv2d_avx_folded(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    return conv2d_folded<AvxOps>(params, out, out_stride);
+}
+
+// ==========================================================================
+// =========================== Built-in Kernels =============================
+// ==========================================================================
+
+// The built-in 3x3 filters have fixed coefficients, so each gets its own loop
+// body with the taps as immediates: zero taps disappear, +-1 taps become adds
+// and subtracts and Sobel's 2x is an add. Only kernels that still hold the
+// factory's exact values (any source, including files) take these paths.
+
+constexpr float GAUSSIAN_3X3_CORNER = GAUSSIAN_1D_3[0] * GAUSSIAN_1D_3[0];
+constexpr float GAUSSIAN_3X3_EDGE   = GAUSSIAN_1D_3[0] * GAUSSIAN_1D_3[1];
+constexpr float GAUSSIAN_3X3_CENTRE = GAUSSIAN_1D_3[1] * GAUSSIAN_1D_3[1];
+
+constexpr float BOX_3X3 = 1.0f / 9;
+
+static bool is_builtin_3x3(const Kernel& kernel) {
+    if (kernel.size != KERNEL_SIZE_3)
+        return false;
+
+    float expected[9];
+
+    switch (kernel.type) {
+        case KERNEL_TYPE_SHARPEN:
+            std::memcpy(expected, SHARPEN_3X3, sizeof(expected));
+            break;
+
+        case KERNEL_TYPE_SOBEL_X:
+            std::memcpy(expected, SOBEL_X_3X3, sizeof(expected));
+            break;
+
+        case KERNEL_TYPE_SOBEL_Y:
+            std::memcpy(expected, SOBEL_Y_3X3, sizeof(expected));
+            break;
+
+        case KERNEL_TYPE_BOX_BLUR:
+            for (float& tap : expected)
+                tap = BOX_3X3;
+            break;
+
+        case KERNEL_TYPE_GAUSSIAN_BLUR:
+            for (int y = 0; y < 3; y++)
+                for (int x = 0; x < 3; x++)
+                    expected[y * 3 + x] = GAUSSIAN_1D_3[y] * GAUSSIAN_1D_3[x];
+            break;
+
+        default:
+            return false;
+    }
+
+    return std::memcmp(kernel.data, expected, sizeof(expected)) == 0;
+}
+
+// One output vector at p (top-left of the window), rows s floats apart
+template <typename Ops, int Type>
+static inline typename Ops::Vec builtin_3x3(const typename Ops::Elem *p, int s) {
+    typedef typename Ops::Vec Vec;
+
+    auto at = [&](int y, int x) { return Ops::load(p + y * s + x); };
+
+    if constexpr (Type == KERNEL_TYPE_SHARPEN) {
+        Vec cross = Ops::add(Ops::add(at(0, 1), at(1, 0)), Ops::add(at(1, 2), at(2, 1)));
+        return Ops::sub(Ops::mul(at(1, 1), Ops::set1(5.0f)), cross);
+    } 
+    else if constexpr (Type == KERNEL_TYPE_SOBEL_X) {
+        Vec mid = Ops::sub(at(1, 2), at(1, 0));
+        Vec out = Ops::add(Ops::sub(at(0, 2), at(0, 0)), Ops::sub(at(2, 2), at(2, 0)));
+        return Ops::add(out, Ops::add(mid, mid));
+    } 
+    else if constexpr (Type == KERNEL_TYPE_SOBEL_Y) {
+        Vec mid = Ops::sub(at(2, 1), at(0, 1));
+        Vec out = Ops::add(Ops::sub(at(2, 0), at(0, 0)), Ops::sub(at(2, 2), at(0, 2)));
+        return Ops::add(out, Ops::add(mid, mid));
+    } 
+    else if constexpr (Type == KERNEL_TYPE_BOX_BLUR) {
+        Vec r0 = Ops::add(Ops::add(at(0, 0), at(0, 1)), at(0, 2));
+        Vec r1 = Ops::add(Ops::add(at(1, 0), at(1, 1)), at(1, 2));
+        Vec r2 = Ops::add(Ops::add(at(2, 0), at(2, 1)), at(2, 2));
+        return Ops::mul(Ops::add(Ops::add(r0, r1), r2), Ops::set1(BOX_3X3));
+    } 
+    else {
+        Vec corners = Ops::add(Ops::add(at(0, 0), at(0, 2)), Ops::add(at(2, 0), at(2, 2)));
+        Vec edges   = Ops::add(Ops::add(at(0, 1), at(2, 1)), Ops::add(at(1, 0), at(1, 2)));
+
+        Vec out = Ops::mul(corners, Ops::set1(GAUSSIAN_3X3_CORNER));
+        out = Ops::add(out, Ops::mul(edges, Ops::set1(GAUSSIAN_3X3_EDGE)));
+        return Ops::add(out, Ops::mul(at(1, 1), Ops::set1(GAUSSIAN_3X3_CENTRE)));
+    }
+}
+
+template <typename Ops, int Type>
+static void conv2d_builtin_3x3(
+    const Conv2DParams& params, 
+    typename Ops::Elem *out,
+    int out_stride
+) {
+    typedef typename Ops::Elem Elem;
+    typedef typename Ops::Acc Acc;
+
+    Image image = params.image;
+    Kernel kernel = params.kernel;
+
+    int out_height = (image.height - kernel.size) / params.stride + 1;
+    int out_width  = (image.width - kernel.size) / params.stride + 1;
+
+    const int in_stride = image_row_stride(image);
+    const int stride    = params.stride;
+
+    const Elem *src = reinterpret_cast<const Elem*>(image.data);
+
+    const bool aligned_out = is_aligned(out, Ops::WIDTH * sizeof(Elem)) && out_stride % Ops::WIDTH == 0;
+
+    for (int i = 0; i < out_height; i++) {
+        int base_i = i * stride;
+
+        int j = 0;
+        for (; j <= out_width - Ops::WIDTH; j += Ops::WIDTH) {
+            const Elem *p = &src[base_i * in_stride + j * stride];
+            Ops::store(&out[i * out_stride + j], builtin_3x3<Ops, Type>(p, in_stride), aligned_out);
+        }
+
+        for (; j < out_width; j++) {
+            int base_j = j * stride;
+            Acc s = 0;
+            for (int ky = 0; ky < 3; ky++)
+                for (int kx = 0; kx < 3; kx++)
+                    s += Ops::to_acc(src[(base_i + ky) * in_stride + (base_j + kx)]) *
+                         kernel.data[ky * 3 + kx];
+
+            out[i * out_stride + j] = Ops::from_acc(s);
+        }
+    }
+}
+
+template <typename Ops>
+static int conv2d_builtin(
+    const Conv2DParams& params, 
+    typename Ops::Elem *out,
+    int out_stride
+) {
+    switch (params.kernel.type) {
+        case KERNEL_TYPE_SHARPEN:
+            conv2d_builtin_3x3<Ops, KERNEL_TYPE_SHARPEN>(params, out, out_stride);
+            break;
+        case KERNEL_TYPE_SOBEL_X:
+            conv2d_builtin_3x3<Ops, KERNEL_TYPE_SOBEL_X>(params, out, out_stride);
+            break;
+        case KERNEL_TYPE_SOBEL_Y:
+            conv2d_builtin_3x3<Ops, KERNEL_TYPE_SOBEL_Y>(params, out, out_stride);
+            break;
+        case KERNEL_TYPE_BOX_BLUR:
+            conv2d_builtin_3x3<Ops, KERNEL_TYPE_BOX_BLUR>(params, out, out_stride);
+            break;
+        case KERNEL_TYPE_GAUSSIAN_BLUR:
+            conv2d_builtin_3x3<Ops, KERNEL_TYPE_GAUSSIAN_BLUR>(params, out, out_stride);
+            break;
+        default:
+            return CODE_FAILURE_INVALID_ARG;
+    }
+
+    return CODE_SUCCESS;
+}
+
+static int conv2d_sse_builtin(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    return conv2d_builtin<SseOps>(params, out, out_stride);
+}
+
+static int conv2d_avx_builtin(
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    return conv2d_builtin<AvxOps>(params, out, out_stride);
+}
+
+// ==========================================================================
+// ============================ Storage Types ===============================
+// ==========================================================================
+
+// f64, f16 and bf16 run the same engines templated on storage: elements are
+// widened on load, summed in Storage::Acc and narrowed once on store, so
+// half-precision images move half the bytes of f32 ones.
+
+template <typename Storage>
+static int conv2d_baseline_typed(
+    const Conv2DParams& params, 
+    typename Storage::Elem *out,
+    int out_stride
+) {
+    typedef typename Storage::Elem Elem;
+    typedef typename Storage::Acc Acc;
+
+    Image image = params.image;
+    Kernel kernel = params.kernel;
+
+    int out_height = (image.height - kernel.size) / params.stride + 1;
+    int out_width  = (image.width - kernel.size) / params.stride + 1;
+
+    const int in_stride = image_row_stride(image);
+
+    const Elem *src = reinterpret_cast<const Elem*>(image.data);
+
+    for (int i = 0; i < out_height; i++) {
+        for (int j = 0; j < out_width; j++) {
+
+            Acc sum = 0;
+
+            int base_i = i * params.stride;
+            int base_j = j * params.stride;
+
+            for (int u = 0; u < kernel.size; u++) {
+                for (int v = 0; v < kernel.size; v++) {
+                    sum += Storage::to_acc(src[(base_i + u) * in_stride + (base_j + v)]) *
+                           kernel.data[u * kernel.size + v];
+                }
+            }
+
+            out[i * out_stride + j] = Storage::from_acc(sum);
+        }
+    }
+
+    return CODE_SUCCESS;
+}
+
+template <typename Storage, typename Sse, typename Avx>
+static int conv2d_typed(
+    int engine_mode, 
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    typedef typename Storage::Elem Elem;
+
+    Elem *dst = reinterpret_cast<Elem*>(out);
+
+    // conv2d_folded() covers plain kernels too (no fold on either axis)
+    switch (engine_mode) {
+        case ENGINE_MODE_BASELINE:
+            return conv2d_baseline_typed<Storage>(params, dst, out_stride);
+
+        case ENGINE_MODE_SSE:
+            return is_builtin_3x3(params.kernel)
+                ? conv2d_builtin<Sse>(params, dst, out_stride)
+                : conv2d_folded<Sse>(params, dst, out_stride);
+
+        case ENGINE_MODE_AVX:
+            return is_builtin_3x3(params.kernel)
+                ? conv2d_builtin<Avx>(params, dst, out_stride)
+                : conv2d_folded<Avx>(params, dst, out_stride);
+
+        default:
+            return CODE_FAILURE;
+    }
+}
+
+static int conv2d_storage(
+    int engine_mode, 
+    const Conv2DParams& params, 
+    float *out,
+    int out_stride
+) {
+    switch (params.image.dtype) {
+        case DTYPE_F64:
+            return conv2d_typed<F64Storage, SseF64Ops, AvxF64Ops>(engine_mode, params, out, out_stride);
+        case DTYPE_F16:
+            return conv2d_typed<F16Storage, SseF16Ops, AvxF16Ops>(engine_mode, params, out, out_stride);
+        case DTYPE_BF16:
+            return conv2d_typed<Bf16Storage, SseBf16Ops, AvxBf16Ops>(engine_mode, params, out, out_stride);
+        default:
+            return CODE_FAILURE_NOT_SUPPORTED;
+    }
+}
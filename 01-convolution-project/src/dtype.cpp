@@ -0,0 +1,63 @@
+#include <cstring>
+
+#include "dtype.h"
+#include "constants.h"
+#include "utility.h"
+
+static double load_element(const void *row, int dtype, int x) {
+    switch (dtype) {
+        case DTYPE_F64:  return static_cast<const double*>(row)[x];
+        case DTYPE_F16:  return half_to_float(static_cast<const uint16_t*>(row)[x]);
+        case DTYPE_BF16: return bf16_to_float(static_cast<const uint16_t*>(row)[x]);
+        default:         return static_cast<const float*>(row)[x];
+    }
+}
+
+static void store_element(void *row, int dtype, int x, double value) {
+    switch (dtype) {
+        case DTYPE_F64:  static_cast<double*>(row)[x]   = value;                          break;
+        case DTYPE_F16:  static_cast<uint16_t*>(row)[x] = float_to_half((float) value);   break;
+        case DTYPE_BF16: static_cast<uint16_t*>(row)[x] = float_to_bf16((float) value);   break;
+        default:         static_cast<float*>(row)[x]    = (float) value;                  break;
+    }
+}
+
+static bool is_valid_dtype(int dtype) {
+    return (
+        dtype == DTYPE_F32 ||
+        dtype == DTYPE_F64 ||
+        dtype == DTYPE_F16 ||
+        dtype == DTYPE_BF16
+    );
+}
+
+// Conversions only happen at load/save boundaries, so a scalar loop is fine;
+// same-dtype copies are row memcpys.
+int image_convert(const Image& src, const Image& dst) {
+
+    if (
+        !src.data || !dst.data ||
+        !is_valid_dtype(src.dtype) || !is_valid_dtype(dst.dtype) ||
+        src.height != dst.height || src.width != dst.width || src.channels != dst.channels
+    ) {
+        print_err("Invalid arguments to function", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    for (int c = 0; c < src.channels; c++) {
+        for (int y = 0; y < src.height; y++) {
+            const void *in = image_element(src, c * image_channel_stride(src) + (size_t) y * image_row_stride(src));
+            void *out      = image_element(dst, c * image_channel_stride(dst) + (size_t) y * image_row_stride(dst));
+
+            if (src.dtype == dst.dtype) {
+                std::memcpy(out, in, src.width * dtype_size(src.dtype));
+                continue;
+            }
+
+            for (int x = 0; x < src.width; x++)
+                store_element(out, dst.dtype, x, load_element(in, src.dtype, x));
+        }
+    }
+
+    return CODE_SUCCESS;
+}
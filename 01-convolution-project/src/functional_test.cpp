@@ -4,8 +4,10 @@
 #include "conv2d.h"
 #include "io.h"
 #include "kernel_factory.h"
+#include "perf_counters.h"
 #include "utility.h"
 #include "constants.h"
+#include "tensor.h"
 
 int read_functional_test_input(FunctionalTestParams& functional_test_params) {
 
@@ -173,12 +175,17 @@ int run_functional_test(const FunctionalTestParams& functional_test_params) {
     int res = CODE_SUCCESS;
 
     Image input_img, output_img;
+    KernelRef kernel_ref;
     Kernel kernel;
 
     int stride = 1;
 
     Conv2DParams conv2d_params;
 
+    PerfCounters perf;
+    PerfSample   perf_sample;
+    bool         use_perf = false;
+
     std::chrono::time_point<std::chrono::high_resolution_clock> t0, t1;
     std::chrono::duration<double, std::milli> elapsed;
 
@@ -192,19 +199,39 @@ int run_functional_test(const FunctionalTestParams& functional_test_params) {
         goto _exit;
     }
 
-    res = get_kernel(
+    if (functional_test_params.dtype != DTYPE_F32) {
+        Tensor input = Tensor::adopt(input_img);
+        res = input.convert_to(functional_test_params.dtype);
+        input_img = input.release();
+
+        if (res != CODE_SUCCESS) {
+            goto _exit;
+        }
+    }
+
+    res = get_kernel_ref(
             functional_test_params.kernel_type,
             functional_test_params.kernel_size,
-            kernel);
+            KERNEL_SIGMA_DEF,
+            kernel_ref);
 
     if (res != CODE_SUCCESS) {
         goto _exit; 
     }
 
+    kernel = kernel_ref->kernel;
+
     conv2d_params.image  = input_img;
     conv2d_params.kernel = kernel;
     conv2d_params.stride = stride;
 
+    if (functional_test_params.perf_counters) {
+        use_perf = perf_counters_open(perf) == CODE_SUCCESS;
+    }
+
+    if (use_perf)
+        perf_counters_start(perf);
+
     t0 = std::chrono::high_resolution_clock::now();
 
     res = conv2d_channels(
@@ -213,9 +240,27 @@ int run_functional_test(const FunctionalTestParams& functional_test_params) {
             output_img);
 
     t1 = std::chrono::high_resolution_clock::now();
+
+    if (use_perf)
+        perf_counters_stop(perf, perf_sample);
     
     elapsed = t1 - t0; 
 
+    if (res != CODE_SUCCESS) {
+        goto _exit;
+    }
+
+    // The writers below read floats
+    if (output_img.dtype != DTYPE_F32) {
+        Tensor output = Tensor::adopt(output_img);
+        res = output.convert_to(DTYPE_F32);
+        output_img = output.release();
+
+        if (res != CODE_SUCCESS) {
+            goto _exit;
+        }
+    }
+
     if (functional_test_params.save_output) {
         res = save_image(
                 functional_test_params.color_mode,
@@ -228,10 +273,17 @@ int run_functional_test(const FunctionalTestParams& functional_test_params) {
 
     print_benchmark(functional_test_params.engine_mode, elapsed.count());
 
+    if (use_perf) {
+        perf_sample.bytes = 
+            (double) input_img.height * input_img.width * input_img.channels * dtype_size(input_img.dtype) +
+            (double) output_img.height * output_img.width * output_img.channels * dtype_size(input_img.dtype);
+        print_perf_report(functional_test_params.engine_mode, perf_sample);
+    }
+
 _exit: 
-    delete[] input_img.data;
-    delete[] output_img.data;
-    delete[] kernel.data;
+    perf_counters_close(perf);
+    tensor_free(input_img.data);
+    tensor_free(output_img.data);
 
     return res;
 }
\ No newline at end of file
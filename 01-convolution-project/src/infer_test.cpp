@@ -3,6 +3,7 @@
 #include "infer_test.h"
 #include "cnn_inference.h"
 #include "constants.h"
+#include "tensor.h"
 #include "utility.h"
 
 int read_infer_test_input(InferTestParams& infer_test_params) {
@@ -122,9 +123,7 @@ int run_infer_test(const InferTestParams& params) {
             return res;
     }
 
-    delete[] model.fc_weight;
-    delete[] model.fc_bias;
-    delete[] model.kernel.data;
+    free_model(model);
 
     return CODE_SUCCESS;
 }
\ No newline at end of file
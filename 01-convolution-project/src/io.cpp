@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include <opencv2/opencv.hpp>
 
@@ -5,11 +6,17 @@
 #include "conv2d.h"
 #include "utility.h"
 #include "constants.h"
+#include "tensor.h"
+#include "dtype.h"
+#include "resize.h"
+#include "trace.h"
 
 int load_grayscale_image(
     const char *filename, 
     Image& image
 ) {
+    TRACE_SCOPE("decode");
+
     // TODO: validation 
 
     cv::Mat img = cv::imread(filename, cv::IMREAD_GRAYSCALE);
@@ -19,23 +26,18 @@ int load_grayscale_image(
         return CODE_FAILURE;
     }
 
-    cv::Mat img_f;
-    img.convertTo(img_f, CV_32F, 1.0  / 255.0);
-
-    image.height   = img_f.rows;
-    image.width    = img_f.cols;
-    image.channels = CHANNELS_GRAYSCALE;
+    image.height         = img.rows;
+    image.width          = img.cols;
+    image.channels       = CHANNELS_GRAYSCALE;
+    image.row_stride     = 0;
+    image.channel_stride = 0;
 
-    image.data = new float[image.height * image.width];
+    image.data = tensor_alloc(image.height * image.width);
 
-    for (int i = 0; i < image.height; i++) {
-        const float *row_ptr = img_f.ptr<float>(i);
-        std::memcpy(
-            image.data + i * image.width, 
-            row_ptr,
-            image.width * sizeof(float)
-        );
-    }
+    // Converts straight into the pooled buffer; a header of matching size
+    // and type is never reallocated by convertTo()
+    cv::Mat plane(image.height, image.width, CV_32F, image.data);
+    img.convertTo(plane, CV_32F, 1.0 / 255.0);
 
     return CODE_SUCCESS;
 }
@@ -44,9 +46,14 @@ int save_float_array_as_grayscale_image(
     const char *filename, 
     const Image& output
 ) {
+    TRACE_SCOPE("encode");
+
     // TODO: validation 
 
-    cv::Mat img_f(output.height, output.width, CV_32F, const_cast<float*>(output.data));
+    cv::Mat img_f(
+        output.height, output.width, CV_32F, 
+        const_cast<float*>(output.data), 
+        image_row_stride(output) * sizeof(float));
 
     cv::Mat img_clamped;
     cv::min(img_f, 1.0f, img_clamped);
@@ -67,28 +74,34 @@ int load_rgb_image(
     const char *filename, 
     Image &image
 ) {
+    TRACE_SCOPE("decode");
+
     cv::Mat img = cv::imread(filename, cv::IMREAD_COLOR);
     if (img.empty()) {
         print_err("Failed to load RGB image", CODE_FAILURE_READ_INPUT);
         return CODE_FAILURE;
     }
 
-    cv::Mat img_f; 
-    img.convertTo(img_f, CV_32F, 1.0 / 255.0);
-
-    image.height   = img_f.rows;
-    image.width    = img_f.cols;
-    image.channels = CHANNELS_RGB;
+    image.height         = img.rows;
+    image.width          = img.cols;
+    image.channels       = CHANNELS_RGB;
+    image.row_stride     = 0;
+    image.channel_stride = 0;
 
     int plane = image.height * image.width;
-    image.data = new float[plane * image.channels];
+    image.data = tensor_alloc(plane * image.channels);
+
+    TRACE_SCOPE("color split");
 
+    // Split the 8-bit pixels, then widen each channel into its pooled plane
+    // (BGR -> RGB order); no full-size float copy is made
     std::vector<cv::Mat> bgr;
-    cv::split(img_f, bgr);
+    cv::split(img, bgr);
 
-    std::memcpy(image.data + 0 * plane, bgr[2].ptr<float>(), plane * sizeof(float));
-    std::memcpy(image.data + 1 * plane, bgr[1].ptr<float>(), plane * sizeof(float));
-    std::memcpy(image.data + 2 * plane, bgr[0].ptr<float>(), plane * sizeof(float));
+    for (int c = 0; c < CHANNELS_RGB; c++) {
+        cv::Mat dst(image.height, image.width, CV_32F, image.data + c * plane);
+        bgr[CHANNELS_RGB - 1 - c].convertTo(dst, CV_32F, 1.0 / 255.0);
+    }
 
     return CODE_SUCCESS;
 }
@@ -97,6 +110,8 @@ int save_float_array_as_rgb_image(
     const char* filename,
     const Image& image
 ) {
+    TRACE_SCOPE("encode");
+
     if (image.channels != CHANNELS_RGB) {
         print_err("Image is not in RGB format", CODE_FAILURE_INVALID_ARG);
         return CODE_FAILURE;
@@ -104,20 +119,20 @@ int save_float_array_as_rgb_image(
 
     int h = image.height;
     int w = image.width;
-    int plane = h * w;
-
-    cv::Mat r(h, w, CV_32F, const_cast<float*>(image.data + 0 * plane));
-    cv::Mat g(h, w, CV_32F, const_cast<float*>(image.data + 1 * plane));
-    cv::Mat b(h, w, CV_32F, const_cast<float*>(image.data + 2 * plane));
+    size_t plane = image_channel_stride(image);
+    size_t step  = image_row_stride(image) * sizeof(float);
 
-    cv::min(r, 1.0f, r); cv::max(r, 0.0f, r);
-    cv::min(g, 1.0f, g), cv::max(g, 0.0f, g);
-    cv::min(b, 1.0f, b); cv::max(b, 0.0f, b);
+    cv::Mat r(h, w, CV_32F, const_cast<float*>(image.data + 0 * plane), step);
+    cv::Mat g(h, w, CV_32F, const_cast<float*>(image.data + 1 * plane), step);
+    cv::Mat b(h, w, CV_32F, const_cast<float*>(image.data + 2 * plane), step);
 
     std::vector<cv::Mat> bgr = { b, g, r };
 
+    // Clamp the merged copy so the caller's (possibly shared) view is untouched
     cv::Mat img_f, img_u8;
     cv::merge(bgr, img_f);
+    cv::min(img_f, 1.0f, img_f);
+    cv::max(img_f, 0.0f, img_f);
     img_f.convertTo(img_u8, CV_8U, 255.0);
 
     if (!cv::imwrite(filename, img_u8)) {
@@ -128,6 +143,70 @@ int save_float_array_as_rgb_image(
     return CODE_SUCCESS;
 }
 
+int load_image_as(
+    int color_mode,
+    const std::string& image_path,
+    Image& image
+) {
+    int res = CODE_FAILURE_NOT_SUPPORTED;
+
+    if (color_mode == COLOR_MODE_GRAYSCALE)
+        res = load_grayscale_image(
+                image_path.c_str(), 
+                image);
+    
+    if (color_mode == COLOR_MODE_RGB) 
+        res = load_rgb_image(
+                image_path.c_str(), 
+                image);
+
+    if (res != CODE_SUCCESS) {
+        std::string err_msg = "Failed to load image: " + image_path;
+        print_err(err_msg.c_str(), res);
+    }
+
+    return res;
+}
+
+int save_image_as(
+    int color_mode,
+    const char *output_filename,
+    const Image& output
+) {
+    int res = CODE_FAILURE_NOT_SUPPORTED;
+
+    // Writers read floats; other storage types go through an f32 copy
+    Tensor converted;
+    const Image *image = &output;
+
+    if (output.dtype != DTYPE_F32) {
+        converted = Tensor(output.height, output.width, output.channels);
+        res = image_convert(output, converted.view());
+        if (res != CODE_SUCCESS)
+            return res;
+
+        image = &converted.view();
+        res   = CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    if (color_mode == COLOR_MODE_GRAYSCALE)
+        res = save_float_array_as_grayscale_image(
+            output_filename, 
+            *image);
+
+    if (color_mode == COLOR_MODE_RGB)
+        res = save_float_array_as_rgb_image(
+            output_filename, 
+            *image);
+
+    if (res != CODE_SUCCESS) {
+        std::string err_msg = "Failed to save image: " + std::string(output_filename);
+        print_err(err_msg.c_str(), res);
+    }
+
+    return res;
+}
+
 int load_kernel_from_file(const char* path, Kernel &kernel) {
 
     std::ifstream in(path);
@@ -137,12 +216,13 @@ int load_kernel_from_file(const char* path, Kernel &kernel) {
     }
 
     kernel.size = KERNEL_SIZE_3;
-    kernel.data = new float[kernel.size * kernel.size];
+    kernel.data = tensor_alloc(kernel.size * kernel.size);
 
     for (int i = 0; i < kernel.size * kernel.size; i++) {
         if (!(in >> kernel.data[i])) {
             print_err("Invalid kernel format", CODE_FAILURE_INVALID_INPUT);
-            delete[] kernel.data;
+            tensor_free(kernel.data);
+            kernel.data = nullptr;
             return CODE_FAILURE;
         }
     }
@@ -161,11 +241,11 @@ float* load_matrix(
         print_err("Failed to open matrix file", CODE_FAILURE_READ_INPUT);
         return nullptr;
     }
-    float* data = new float[rows * cols];
+    float* data = tensor_alloc(rows * cols);
     for (int i = 0; i < rows * cols; i++) {
         if (!(in >> data[i])) {
             print_err("Invalid matrix format", CODE_FAILURE_INVALID_INPUT);
-            delete[] data;
+            tensor_free(data);
             return nullptr;
         }
     }
@@ -184,12 +264,12 @@ float* load_vector(
         return nullptr;
     }
 
-    float* data = new float[size];
+    float* data = tensor_alloc(size);
 
     for (int i = 0; i < size; i++) {
         if (!(in >> data[i])) {
             print_err("Invalid vector format", CODE_FAILURE_INVALID_INPUT);
-            delete[] data;
+            tensor_free(data);
             return nullptr;
         }
     }
@@ -199,67 +279,55 @@ float* load_vector(
 }
 
 int resize_image(
+    int engine_mode,
     Image& image,
     int new_width,
     int new_height
 ) {
-    int old_width  = image.width;
-    int old_height = image.height;
+    TRACE_SCOPE("resize");
 
-    float* old_data = image.data;
-    float* new_data = new float[new_width * new_height];
-
-    float scale_x = static_cast<float>(old_width)  / new_width;
-    float scale_y = static_cast<float>(old_height) / new_height;
-
-    for (int y = 0; y < new_height; y++) {
-        for (int x = 0; x < new_width; x++) {
-
-            // PIL coordinate transform
-            float src_x = (x + 0.5f) * scale_x - 0.5f;
-            float src_y = (y + 0.5f) * scale_y - 0.5f;
-
-            int x0 = static_cast<int>(floor(src_x));
-            int y0 = static_cast<int>(floor(src_y));
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-
-            // Clamp
-            x0 = std::max(0, std::min(x0, old_width - 1));
-            x1 = std::max(0, std::min(x1, old_width - 1));
-            y0 = std::max(0, std::min(y0, old_height - 1));
-            y1 = std::max(0, std::min(y1, old_height - 1));
+    if (new_width <= 0 || new_height <= 0) {
+        print_err("Invalid resize target", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
 
-            float dx = src_x - x0;
-            float dy = src_y - y0;
+    // A strided image is a view into someone else's buffer, which must not
+    // be handed to tensor_free(); resize those with resize_channels_into()
+    if (
+        image_row_stride(image) != image.width ||
+        image_channel_stride(image) != (size_t) image.height * image.width
+    ) {
+        print_err("resize_image() needs a packed image that owns its buffer", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
 
-            float v00 = old_data[y0 * old_width + x0];
-            float v01 = old_data[y0 * old_width + x1];
-            float v10 = old_data[y1 * old_width + x0];
-            float v11 = old_data[y1 * old_width + x1];
+    if (image.dtype != DTYPE_F32) {
+        print_err("resize_image() only takes f32 images", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
 
-            // Bilinear interpolation
-            float value =
-                (1 - dx) * (1 - dy) * v00 +
-                dx       * (1 - dy) * v01 +
-                (1 - dx) * dy       * v10 +
-                dx       * dy       * v11;
+    Image resized;
+    resized.height   = new_height;
+    resized.width    = new_width;
+    resized.channels = image.channels;
+    resized.data     = tensor_alloc((size_t) new_width * new_height * image.channels);
 
-            new_data[y * new_width + x] = value;
-        }
+    int res = resize_channels_into(engine_mode, image, resized);
+    if (res != CODE_SUCCESS) {
+        tensor_free(resized.data);
+        return res;
     }
 
-    delete[] image.data;
-
-    image.width  = new_width;
-    image.height = new_height;
-    image.data   = new_data;
+    tensor_free(image.data);
+    image = resized;
 
     return CODE_SUCCESS;
 }
 
 int load_tensor(const std::string& path, Image& image)
 {
+    TRACE_SCOPE("load tensor");
+
     std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file)
         return CODE_FAILURE;
@@ -268,19 +336,123 @@ int load_tensor(const std::string& path, Image& image)
     file.seekg(0, std::ios::beg);
 
     if (size != 64 * 64 * sizeof(float)) {
-        std::cerr << "Unexpected file size: " << size << std::endl;
+        print_err("Unexpected tensor file size", CODE_FAILURE_INVALID_INPUT);
         return CODE_FAILURE;
     }
 
     image.width = 64;
     image.height = 64;
     image.channels = 1;   // 🔥 YOU FORGOT THIS
-    image.data = new float[64 * 64];
+    image.row_stride     = 0;
+    image.channel_stride = 0;
+    image.data = tensor_alloc(64 * 64);
 
     if (!file.read(reinterpret_cast<char*>(image.data), size)) {
-        std::cerr << "Read failed\n";
+        print_err("Failed to read tensor file", CODE_FAILURE_READ_INPUT);
+        tensor_free(image.data);
+        image.data = nullptr;
         return CODE_FAILURE;
     }
 
     return CODE_SUCCESS;
-}
\ No newline at end of file
+}
+
+int image_from_mat(
+    const cv::Mat& mat,
+    Image& image
+) {
+    if (mat.empty() || mat.type() != CV_32FC1) {
+        print_err("Only single channel float matrices can be viewed", CODE_FAILURE_NOT_SUPPORTED);
+        return CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    if (mat.step[0] % sizeof(float) != 0) {
+        print_err("Matrix row pitch is not a whole number of floats", CODE_FAILURE_NOT_SUPPORTED);
+        return CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    image.data           = const_cast<float*>(mat.ptr<float>(0));
+    image.height         = mat.rows;
+    image.width          = mat.cols;
+    image.channels       = CHANNELS_GRAYSCALE;
+    image.row_stride     = (int) (mat.step[0] / sizeof(float));
+    image.channel_stride = 0;
+
+    return CODE_SUCCESS;
+}
+
+int frame_to_image(
+    const cv::Mat& frame,
+    const Image& image
+) {
+    TRACE_SCOPE("frame to image");
+
+    if (
+        frame.depth() != CV_8U || (frame.channels() != 1 && frame.channels() != 3) ||
+        frame.rows != image.height || frame.cols != image.width ||
+        (image.channels != CHANNELS_GRAYSCALE && image.channels != CHANNELS_RGB)
+    ) {
+        print_err("Frame does not match the image buffer", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    const float scale = 1.0f / 255.0f;
+    size_t plane = image_channel_stride(image);
+
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char *src = frame.ptr<unsigned char>(y);
+        float *dst = image.data + y * image_row_stride(image);
+
+        if (frame.channels() == 3 && image.channels == CHANNELS_RGB) {
+            for (int x = 0; x < image.width; x++) {
+                dst[0 * plane + x] = src[3 * x + 2] * scale;
+                dst[1 * plane + x] = src[3 * x + 1] * scale;
+                dst[2 * plane + x] = src[3 * x + 0] * scale;
+            }
+        } else if (frame.channels() == 3) {
+            // BT.601 luma, as cv::IMREAD_GRAYSCALE does
+            for (int x = 0; x < image.width; x++)
+                dst[x] = (0.299f * src[3 * x + 2] + 0.587f * src[3 * x + 1] + 0.114f * src[3 * x]) * scale;
+        } else {
+            for (int c = 0; c < image.channels; c++)
+                for (int x = 0; x < image.width; x++)
+                    dst[c * plane + x] = src[x] * scale;
+        }
+    }
+
+    return CODE_SUCCESS;
+}
+
+int image_to_frame(
+    const Image& image,
+    cv::Mat& frame
+) {
+    TRACE_SCOPE("image to frame");
+
+    if (image.channels != CHANNELS_GRAYSCALE && image.channels != CHANNELS_RGB) {
+        print_err("Only grayscale and RGB images can be encoded", CODE_FAILURE_NOT_SUPPORTED);
+        return CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    // No-op when the frame already has this geometry
+    frame.create(image.height, image.width, image.channels == CHANNELS_RGB ? CV_8UC3 : CV_8UC1);
+
+    size_t plane = image_channel_stride(image);
+
+    for (int y = 0; y < image.height; y++) {
+        const float *src = image.data + y * image_row_stride(image);
+        unsigned char *dst = frame.ptr<unsigned char>(y);
+
+        for (int x = 0; x < image.width; x++) {
+            for (int c = 0; c < image.channels; c++) {
+                float v = std::min(std::max(src[c * plane + x], 0.0f), 1.0f);
+
+                // planar RGB -> interleaved BGR
+                int out_c = image.channels == CHANNELS_RGB ? 2 - c : 0;
+                dst[image.channels * x + out_c] = (unsigned char) (v * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    return CODE_SUCCESS;
+}
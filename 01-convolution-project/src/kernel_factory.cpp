@@ -1,11 +1,18 @@
 #include "kernel_factory.h"
+#include "builtin_kernels.h"
 #include "constants.h"
+#include "tensor.h"
 #include "utility.h"
 
 #include <cmath>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
-static bool validate_odd_kernel(int k) {
+bool validate_odd_kernel(int k) {
     return (k >= 3 && k % 2 == 1);
 }
 
@@ -16,13 +23,7 @@ static int create_sharpen(Kernel& kernel) {
         return CODE_FAILURE_NOT_SUPPORTED;
     }
 
-    float data[9] = {
-         0, -1,  0,
-        -1,  5, -1,
-         0, -1,  0
-    };
-
-    std::memcpy(kernel.data, data, 9 * sizeof(float));
+    std::memcpy(kernel.data, SHARPEN_3X3, 9 * sizeof(float));
     return CODE_SUCCESS;
 }
 
@@ -33,13 +34,7 @@ static int create_sobel_x(Kernel& kernel) {
         return CODE_FAILURE_NOT_SUPPORTED;
     }
 
-    float data[9] = {
-        -1, 0, 1,
-        -2, 0, 2,
-        -1, 0, 1
-    };
-
-    std::memcpy(kernel.data, data, 9 * sizeof(float));
+    std::memcpy(kernel.data, SOBEL_X_3X3, 9 * sizeof(float));
     return CODE_SUCCESS;
 }
 
@@ -50,13 +45,7 @@ static int create_sobel_y(Kernel& kernel) {
         return CODE_FAILURE_NOT_SUPPORTED;
     }
 
-    float data[9] = {
-        -1, -2, -1,
-         0,  0,  0,
-         1,  2,  1
-    };
-
-    std::memcpy(kernel.data, data, 9 * sizeof(float));
+    std::memcpy(kernel.data, SOBEL_Y_3X3, 9 * sizeof(float));
     return CODE_SUCCESS;
 }
 
@@ -77,7 +66,9 @@ static int create_box_blur(Kernel& kernel) {
     return CODE_SUCCESS;
 }
 
-static int create_gaussian_blur(Kernel& kernel) {
+// The 2D Gaussian is the outer product of two 1D ones, so only size exp()
+// calls are needed instead of size * size.
+static int create_gaussian_blur(Kernel& kernel, float sigma) {
 
     if (!validate_odd_kernel(kernel.size)) {
         print_err("Gaussian kernel size must be odd and >= 3", CODE_FAILURE_NOT_SUPPORTED);
@@ -87,75 +78,226 @@ static int create_gaussian_blur(Kernel& kernel) {
     int k = kernel.size;
     int half = k / 2;
 
-    float sigma = k / 3.0f;
+    std::vector<float> taps(k);
 
-    float sum = 0.0f;
-
-    for (int y = -half; y <= half; y++) {
-        for (int x = -half; x <= half; x++) {
+    // Default-sigma profiles are baked; only custom sigmas reach exp()
+    const float *baked = gaussian_1d_table(k);
 
-            float exponent = -(x * x + y * y) / (2.0f * sigma * sigma);
-            float value = std::exp(exponent);
+    if (baked && sigma == k / 3.0f) {
+        std::memcpy(taps.data(), baked, k * sizeof(float));
+    } else {
+        float sum = 0.0f;
 
-            int idx = (y + half) * k + (x + half);
-            kernel.data[idx] = value;
+        for (int x = -half; x <= half; x++) {
+            float exponent = -(x * x) / (2.0f * sigma * sigma);
+            taps[x + half] = std::exp(exponent);
+            sum += taps[x + half];
+        }
 
-            sum += value;
+        for (int x = 0; x < k; x++) {
+            taps[x] /= sum;
         }
     }
 
-    for (int i = 0; i < k * k; i++) {
-        kernel.data[i] /= sum;
+    for (int y = 0; y < k; y++) {
+        for (int x = 0; x < k; x++) {
+            kernel.data[y * k + x] = taps[y] * taps[x];
+        }
     }
 
     return CODE_SUCCESS;
 }
 
-int get_kernel(int kernel_type, int kernel_size, Kernel& kernel) {
+static int fill_kernel(Kernel& kernel, float sigma) {
 
-    if (!validate_odd_kernel(kernel_size)) {
-        print_err("Kernel size must be odd and >= 3", CODE_FAILURE_NOT_SUPPORTED);
-        return CODE_FAILURE_NOT_SUPPORTED;
-    }
-
-    kernel.size = kernel_size;
-    kernel.type = kernel_type;
-    kernel.data = new float[kernel_size * kernel_size];
-
-    int status = CODE_SUCCESS;
-
-    switch (kernel_type) {
+    switch (kernel.type) {
 
         case KERNEL_TYPE_SHARPEN:
-            status = create_sharpen(kernel);
-            break;
+            return create_sharpen(kernel);
 
         case KERNEL_TYPE_SOBEL_X:
-            status = create_sobel_x(kernel);
-            break;
+            return create_sobel_x(kernel);
 
         case KERNEL_TYPE_SOBEL_Y:
-            status = create_sobel_y(kernel);
-            break;
+            return create_sobel_y(kernel);
 
         case KERNEL_TYPE_BOX_BLUR:
-            status = create_box_blur(kernel);
-            break;
+            return create_box_blur(kernel);
 
         case KERNEL_TYPE_GAUSSIAN_BLUR:
-            status = create_gaussian_blur(kernel);
-            break;
+            return create_gaussian_blur(kernel, sigma);
 
         default:
             print_err("Unsupported kernel type", CODE_FAILURE_NOT_SUPPORTED);
-            status = CODE_FAILURE_NOT_SUPPORTED;
-            break;
+            return CODE_FAILURE_NOT_SUPPORTED;
+    }
+}
+
+// ==========================================================================
+// ============================ Kernel Registry =============================
+// ==========================================================================
+
+KernelEntry::~KernelEntry() {
+    tensor_free(kernel.data);
+    tensor_free(taps);
+    tensor_free(row);
+    tensor_free(col);
+}
+
+int find_kernel_symmetry(const float *data, int size) {
+    bool symmetric_h = true, symmetric_v = true;
+    bool antisymmetric_h = true, antisymmetric_v = true;
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float v  = data[y * size + x];
+            float mh = data[y * size + (size - 1 - x)];
+            float mv = data[(size - 1 - y) * size + x];
+
+            if (v != mh)  symmetric_h = false;
+            if (v != -mh) antisymmetric_h = false;
+            if (v != mv)  symmetric_v = false;
+            if (v != -mv) antisymmetric_v = false;
+        }
     }
 
-    if (status != CODE_SUCCESS) {
-        delete[] kernel.data;
-        kernel.data = nullptr;
+    // An all-zero row or column satisfies both; symmetric wins
+    int symmetry = KERNEL_SYMMETRY_NONE;
+
+    if (symmetric_h)          symmetry |= KERNEL_SYMMETRIC_H;
+    else if (antisymmetric_h) symmetry |= KERNEL_ANTISYMMETRIC_H;
+
+    if (symmetric_v)          symmetry |= KERNEL_SYMMETRIC_V;
+    else if (antisymmetric_v) symmetry |= KERNEL_ANTISYMMETRIC_V;
+
+    return symmetry;
+}
+
+// Rank-1 test: take the largest tap as pivot, read the row and column through
+// it and check that their outer product reproduces every tap.
+static void find_separable_factors(KernelEntry& entry) {
+    const float *d = entry.kernel.data;
+    int k = entry.kernel.size;
+
+    int p = 0;
+    for (int i = 1; i < k * k; i++) {
+        if (std::fabs(d[i]) > std::fabs(d[p]))
+            p = i;
     }
 
-    return status;
+    float pivot = d[p];
+    if (pivot == 0.0f)
+        return;
+
+    int py = p / k;
+    int px = p % k;
+
+    entry.row = tensor_alloc(k);
+    entry.col = tensor_alloc(k);
+
+    for (int x = 0; x < k; x++) entry.row[x] = d[py * k + x];
+    for (int y = 0; y < k; y++) entry.col[y] = d[y * k + px] / pivot;
+
+    float tolerance = KERNEL_SEPARABLE_EPS * std::fabs(pivot);
+
+    for (int y = 0; y < k; y++) {
+        for (int x = 0; x < k; x++) {
+            if (std::fabs(entry.col[y] * entry.row[x] - d[y * k + x]) > tolerance) {
+                tensor_free(entry.row);
+                tensor_free(entry.col);
+                entry.row = entry.col = nullptr;
+                return;
+            }
+        }
+    }
+
+    entry.separable = true;
+}
+
+static int build_kernel_entry(int kernel_type, int kernel_size, float sigma, KernelEntry& entry) {
+
+    size_t taps = (size_t) kernel_size * kernel_size;
+
+    entry.sigma       = sigma;
+    entry.kernel.size = kernel_size;
+    entry.kernel.type = kernel_type;
+    entry.kernel.data = tensor_alloc(taps);
+
+    int status = fill_kernel(entry.kernel, sigma);
+    if (status != CODE_SUCCESS)
+        return status;
+
+    entry.taps = tensor_alloc(taps * KERNEL_TAP_LANES);
+    for (size_t i = 0; i < taps; i++) {
+        for (int lane = 0; lane < KERNEL_TAP_LANES; lane++) {
+            entry.taps[i * KERNEL_TAP_LANES + lane] = entry.kernel.data[i];
+        }
+    }
+    entry.kernel.taps = entry.taps;
+
+    entry.kernel.symmetry = find_kernel_symmetry(entry.kernel.data, kernel_size);
+    find_separable_factors(entry);
+
+    return CODE_SUCCESS;
+}
+
+typedef std::tuple<int, int, float> KernelKey;
+
+struct KernelRegistry {
+    std::mutex mutex;
+    std::map<KernelKey, KernelRef> entries;
+};
+
+// Deliberately never destroyed: entries free into the tensor pool, which may
+// already be gone during static destruction at exit.
+static KernelRegistry& get_registry() {
+    static KernelRegistry *registry = new KernelRegistry;
+    return *registry;
+}
+
+int get_kernel_ref(int kernel_type, int kernel_size, float sigma, KernelRef& ref) {
+
+    if (!validate_odd_kernel(kernel_size)) {
+        print_err("Kernel size must be odd and >= 3", CODE_FAILURE_NOT_SUPPORTED);
+        return CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    if (sigma < 0.0f || !std::isfinite(sigma)) {
+        print_err("Gaussian sigma must be positive", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    // Key on the resolved sigma so the default and an explicit size / 3 share
+    if (kernel_type != KERNEL_TYPE_GAUSSIAN_BLUR)
+        sigma = 0.0f;
+    else if (sigma == KERNEL_SIGMA_DEF)
+        sigma = kernel_size / 3.0f;
+
+    KernelKey key(kernel_type, kernel_size, sigma);
+
+    KernelRegistry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto it = registry.entries.find(key);
+    if (it != registry.entries.end()) {
+        ref = it->second;
+        return CODE_SUCCESS;
+    }
+
+    std::shared_ptr<KernelEntry> entry = std::make_shared<KernelEntry>();
+
+    int status = build_kernel_entry(kernel_type, kernel_size, sigma, *entry);
+    if (status != CODE_SUCCESS)
+        return status;
+
+    registry.entries[key] = entry;
+    ref = entry;
+
+    return CODE_SUCCESS;
+}
+
+void clear_kernel_registry() {
+    KernelRegistry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.entries.clear();
 }
@@ -0,0 +1,371 @@
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "libconv2d.h"
+#include "cnn_inference.h"
+#include "constants.h"
+#include "conv2d.h"
+#include "kernel_factory.h"
+#include "resize.h"
+#include "tensor.h"
+#include "utility.h"
+
+// The C codes are part of the ABI; keep them pinned to the internal ones
+static_assert(CONV2D_OK                   == CODE_SUCCESS,                "");
+static_assert(CONV2D_ERROR                == CODE_FAILURE,                "");
+static_assert(CONV2D_ERROR_INVALID_ARG    == CODE_FAILURE_INVALID_ARG,    "");
+static_assert(CONV2D_ERROR_READ_INPUT     == CODE_FAILURE_READ_INPUT,     "");
+static_assert(CONV2D_ERROR_INVALID_INPUT  == CODE_FAILURE_INVALID_INPUT,  "");
+static_assert(CONV2D_ERROR_NOT_SUPPORTED  == CODE_FAILURE_NOT_SUPPORTED,  "");
+static_assert(CONV2D_ERROR_FILE_NOT_FOUND == CODE_FAILURE_FILE_NOT_FOUND, "");
+static_assert(CONV2D_ERROR_OUT_OF_MEMORY  == CODE_FAILURE_OUT_OF_MEMORY,  "");
+
+static_assert(CONV2D_STATUS_MESSAGE_LEN == sizeof(Conv2DStatus::message), "");
+
+static_assert(CONV2D_ENGINE_BASELINE == ENGINE_MODE_BASELINE, "");
+static_assert(CONV2D_ENGINE_SSE      == ENGINE_MODE_SSE,      "");
+static_assert(CONV2D_ENGINE_AVX      == ENGINE_MODE_AVX,      "");
+
+static_assert(CONV2D_KERNEL_SHARPEN       == KERNEL_TYPE_SHARPEN,       "");
+static_assert(CONV2D_KERNEL_BOX_BLUR      == KERNEL_TYPE_BOX_BLUR,      "");
+static_assert(CONV2D_KERNEL_GAUSSIAN_BLUR == KERNEL_TYPE_GAUSSIAN_BLUR, "");
+static_assert(CONV2D_KERNEL_SOBEL_X       == KERNEL_TYPE_SOBEL_X,       "");
+static_assert(CONV2D_KERNEL_SOBEL_Y       == KERNEL_TYPE_SOBEL_Y,       "");
+
+// Built-in kernels are shared registry entries; custom ones own their data.
+struct conv2d_kernel {
+    Kernel kernel;
+    KernelRef ref;
+};
+
+struct conv2d_model {
+    CNNModel model;
+};
+
+// Pooled allocations throw; nothing may unwind into C callers
+#define CONV2D_API_GUARD(...)                                                   \
+    try {                                                                       \
+        __VA_ARGS__                                                             \
+    } catch (const std::bad_alloc&) {                                           \
+        print_err("Out of memory", CODE_FAILURE_OUT_OF_MEMORY);                 \
+        return CODE_FAILURE_OUT_OF_MEMORY;                                      \
+    } catch (...) {                                                             \
+        print_err("Unexpected exception", CODE_FAILURE);                        \
+        return CODE_FAILURE;                                                    \
+    }
+
+static int fail(const char *msg, int code) {
+    print_err(msg, code);
+    return code;
+}
+
+// Only the documented engines; ENGINE_MODE_AUTO would tune and write a
+// cache file from library code
+static bool is_api_engine(int engine) {
+    return (
+        engine == CONV2D_ENGINE_BASELINE ||
+        engine == CONV2D_ENGINE_SSE      ||
+        engine == CONV2D_ENGINE_AVX
+    );
+}
+
+static bool to_image(const conv2d_image *in, Image& image) {
+    if (
+        !in || !in->data || in->height <= 0 || in->width <= 0 || in->channels <= 0 ||
+        in->row_stride < 0 || in->channel_stride < 0
+    ) {
+        return false;
+    }
+
+    image.data           = in->data;
+    image.height         = in->height;
+    image.width          = in->width;
+    image.channels       = in->channels;
+    image.row_stride     = in->row_stride;
+    image.channel_stride = in->channel_stride;
+
+    return true;
+}
+
+// ==========================================================================
+// ============================ Diagnostics =================================
+// ==========================================================================
+
+static conv2d_log_fn log_fn   = nullptr;
+static void         *log_user = nullptr;
+
+static void forward_log(int log_kind, const char *msg, int errcode, void *) {
+    if (log_fn)
+        log_fn(log_kind == LOG_KIND_ERROR, msg, errcode, log_user);
+}
+
+int conv2d_api_version(void) {
+    return CONV2D_API_VERSION;
+}
+
+const char* conv2d_last_error(void) {
+    return last_error_message();
+}
+
+// Not synchronized: see the header
+void conv2d_set_log_callback(conv2d_log_fn fn, void *user) {
+    log_fn   = fn;
+    log_user = user;
+
+    set_log_handler(fn ? forward_log : nullptr, nullptr);
+}
+
+// ==========================================================================
+// =============================== Buffers ==================================
+// ==========================================================================
+
+float* conv2d_buffer_alloc(size_t count) {
+    try {
+        return tensor_alloc(count);
+    } catch (const std::bad_alloc&) {
+        print_err("Out of memory", CODE_FAILURE_OUT_OF_MEMORY);
+        return nullptr;
+    }
+}
+
+void conv2d_buffer_free(float *data) {
+    tensor_free(data);
+}
+
+// ==========================================================================
+// =============================== Kernels ==================================
+// ==========================================================================
+
+int conv2d_kernel_create(int kernel_type, int kernel_size, conv2d_kernel **out) {
+    if (!out)
+        return fail("Output handle is null", CODE_FAILURE_INVALID_ARG);
+
+    *out = nullptr;
+
+    CONV2D_API_GUARD(
+        KernelRef ref;
+        int res = get_kernel_ref(kernel_type, kernel_size, KERNEL_SIGMA_DEF, ref);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        *out = new conv2d_kernel { ref->kernel, ref };
+        return CODE_SUCCESS;
+    )
+}
+
+int conv2d_kernel_create_from_data(const float *data, int kernel_size, conv2d_kernel **out) {
+    if (!out || !data || !validate_odd_kernel(kernel_size))
+        return fail("Invalid kernel data or size", CODE_FAILURE_INVALID_ARG);
+
+    *out = nullptr;
+
+    CONV2D_API_GUARD(
+        Kernel kernel;
+        kernel.size = kernel_size;
+        kernel.data = tensor_alloc((size_t) kernel_size * kernel_size);
+        std::memcpy(kernel.data, data, (size_t) kernel_size * kernel_size * sizeof(float));
+        kernel.symmetry = find_kernel_symmetry(kernel.data, kernel_size);
+
+        *out = new conv2d_kernel { kernel, KernelRef() };
+        return CODE_SUCCESS;
+    )
+}
+
+int conv2d_kernel_size(const conv2d_kernel *kernel) {
+    return kernel ? kernel->kernel.size : 0;
+}
+
+const float* conv2d_kernel_data(const conv2d_kernel *kernel) {
+    return kernel ? kernel->kernel.data : nullptr;
+}
+
+void conv2d_kernel_free(conv2d_kernel *kernel) {
+    if (!kernel)
+        return;
+
+    if (!kernel->ref)
+        tensor_free(kernel->kernel.data);
+
+    delete kernel;
+}
+
+// ==========================================================================
+// ============================= Convolution ================================
+// ==========================================================================
+
+int conv2d_output_shape(
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    int *out_height,
+    int *out_width
+) {
+    Image image;
+    if (!to_image(input, image) || !kernel || stride < 1 || !out_height || !out_width)
+        return fail("Invalid image, kernel or stride", CODE_FAILURE_INVALID_ARG);
+
+    Conv2DParams params = { image, kernel->kernel, stride };
+    conv2d_output_size(params, *out_height, *out_width);
+
+    if (*out_height <= 0 || *out_width <= 0)
+        return fail("Image is smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+
+    return CODE_SUCCESS;
+}
+
+int conv2d_convolve(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    const conv2d_image *output
+) {
+    if (!is_api_engine(engine))
+        return fail("Invalid engine", CODE_FAILURE_INVALID_ARG);
+
+    Image image, out;
+    if (!to_image(input, image) || !to_image(output, out) || !kernel || stride < 1)
+        return fail("Invalid image, kernel or stride", CODE_FAILURE_INVALID_ARG);
+
+    Conv2DParams params = { image, kernel->kernel, stride };
+
+    CONV2D_API_GUARD(
+        return conv2d_channels_into(engine, params, out);
+    )
+}
+
+int conv2d_workspace_size(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    size_t *count
+) {
+    if (!is_api_engine(engine))
+        return fail("Invalid engine", CODE_FAILURE_INVALID_ARG);
+
+    Image image;
+    if (!to_image(input, image) || !kernel || stride < 1 || !count)
+        return fail("Invalid image, kernel or stride", CODE_FAILURE_INVALID_ARG);
+
+    Conv2DParams params = { image, kernel->kernel, stride };
+    *count = conv2d_workspace_size(engine, params);
+
+    return CODE_SUCCESS;
+}
+
+// Reports through *status only, so it stays off the shared log handler
+int conv2d_convolve_ws(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_kernel *kernel,
+    int stride,
+    const conv2d_image *output,
+    float *workspace,
+    size_t workspace_count,
+    conv2d_status *status
+) {
+    if (!status)
+        return CODE_FAILURE_INVALID_ARG;
+
+    Conv2DStatus result;
+    Image image, out;
+
+    if (!is_api_engine(engine)) {
+        result.code = CODE_FAILURE_INVALID_ARG;
+        std::snprintf(result.message, sizeof(result.message), "Invalid engine");
+    }
+    else if (!to_image(input, image) || !to_image(output, out) || !kernel || stride < 1) {
+        result.code = CODE_FAILURE_INVALID_ARG;
+        std::snprintf(result.message, sizeof(result.message), "Invalid image, kernel or stride");
+    }
+    else {
+        Conv2DParams params = { image, kernel->kernel, stride };
+        conv2d_channels_ws(engine, params, out, workspace, workspace_count, result);
+    }
+
+    status->code     = result.code;
+    status->engine   = result.engine_mode;
+    status->fallback = result.fallback;
+    std::memcpy(status->message, result.message, sizeof(status->message));
+
+    return result.code;
+}
+
+int conv2d_resize(
+    int engine,
+    const conv2d_image *input,
+    const conv2d_image *output
+) {
+    if (!is_api_engine(engine))
+        return fail("Invalid engine", CODE_FAILURE_INVALID_ARG);
+
+    Image image, out;
+    if (!to_image(input, image) || !to_image(output, out))
+        return fail("Invalid input or output image", CODE_FAILURE_INVALID_ARG);
+
+    CONV2D_API_GUARD(
+        return resize_channels_into(engine, image, out);
+    )
+}
+
+// ==========================================================================
+// ============================== Inference =================================
+// ==========================================================================
+
+int conv2d_model_load(
+    const char *kernel_path,
+    const char *fc_weight_path,
+    const char *fc_bias_path,
+    conv2d_model **out
+) {
+    if (!kernel_path || !fc_weight_path || !fc_bias_path || !out)
+        return fail("Model paths and output handle are required", CODE_FAILURE_INVALID_ARG);
+
+    *out = nullptr;
+
+    CONV2D_API_GUARD(
+        InferTestParams params;
+        params.engine_mode    = ENGINE_MODE_BASELINE;
+        params.kernel_path    = kernel_path;
+        params.fc_weight_path = fc_weight_path;
+        params.fc_bias_path   = fc_bias_path;
+
+        CNNModel model;
+        int res = load_model(params, model);
+        if (res != CODE_SUCCESS) {
+            free_model(model);
+            return res;
+        }
+
+        *out = new conv2d_model { model };
+        return CODE_SUCCESS;
+    )
+}
+
+int conv2d_infer(
+    int engine,
+    const conv2d_model *model,
+    const conv2d_image *input,
+    int *predicted_class
+) {
+    if (!is_api_engine(engine))
+        return fail("Invalid engine", CODE_FAILURE_INVALID_ARG);
+
+    Image image;
+    if (!model || !to_image(input, image) || !predicted_class)
+        return fail("Invalid model, image or output", CODE_FAILURE_INVALID_ARG);
+
+    CONV2D_API_GUARD(
+        return infer_image(engine, image, model->model, *predicted_class);
+    )
+}
+
+void conv2d_model_free(conv2d_model *model) {
+    if (!model)
+        return;
+
+    free_model(model->model);
+    delete model;
+}
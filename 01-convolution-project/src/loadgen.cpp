@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "loadgen.h"
+#include "benchmark.h"
+#include "constants.h"
+#include "serve.h"
+#include "shm_ring.h"
+#include "tensor.h"
+#include "utility.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct ClientResult {
+    std::vector<double> latencies_ms;
+    int failures = 0;
+    int res      = CODE_SUCCESS;
+};
+
+static void fill_request(const LoadgenParams& params, ServeRequest& request) {
+    std::memset(&request, 0, sizeof(request));
+
+    request.magic       = SERVE_MAGIC;
+    request.engine_mode = params.engine_mode;
+    request.kernel_type = params.kernel_type;
+    request.kernel_size = params.kernel_size;
+    request.color_mode  = params.color_mode;
+
+    if (!params.input_path.empty()) {
+        request.op         = SERVE_OP_PATH;
+        request.input_len  = (uint32_t) params.input_path.size();
+        request.output_len = (uint32_t) params.output_path.size();
+    } else {
+        request.op       = params.shm ? SERVE_OP_SHM : SERVE_OP_RAW;
+        request.height   = params.frame_size;
+        request.width    = params.frame_size;
+        request.channels = params.color_mode == COLOR_MODE_RGB ? CHANNELS_RGB : CHANNELS_GRAYSCALE;
+    }
+}
+
+// One round trip; the reply payload (raw requests) is read into output.
+static bool send_request(
+    int fd,
+    const LoadgenParams& params,
+    const ServeRequest& request,
+    const Tensor& frame,
+    std::vector<float>& output,
+    ServeResponse& response
+) {
+    if (!serve_send_all(fd, &request, sizeof(request)))
+        return false;
+
+    if (request.op == SERVE_OP_PATH) {
+        if (!serve_send_all(fd, params.input_path.data(), request.input_len) ||
+            !serve_send_all(fd, params.output_path.data(), request.output_len))
+            return false;
+    } else if (request.op == SERVE_OP_RAW) {
+        size_t bytes = (size_t) request.height * request.width * request.channels * sizeof(float);
+        if (!serve_send_all(fd, frame.data(), bytes))
+            return false;
+    }
+
+    if (!serve_recv_all(fd, &response, sizeof(response)) || response.magic != SERVE_MAGIC)
+        return false;
+
+    if (request.op == SERVE_OP_RAW && response.status == CODE_SUCCESS) {
+        output.resize((size_t) response.height * response.width * response.channels);
+        if (!serve_recv_all(fd, output.data(), output.size() * sizeof(float)))
+            return false;
+    }
+
+    return true;
+}
+
+// Creates this client's ring, copies the frame into every input slot once
+// and hands the ring to the server. Input slots are even, outputs odd.
+static int attach_ring(
+    int fd,
+    int client,
+    const LoadgenParams& params,
+    const Tensor& frame,
+    ShmRing& ring
+) {
+    int res = CODE_SUCCESS;
+
+    const Image& image = frame.view();
+    size_t frame_bytes = (size_t) image.height * image.width * image.channels * sizeof(float);
+
+    char name[SML_BUF_SIZE];
+    snprintf(name, sizeof(name), "/conv2d-loadgen-%d-%d", (int) getpid(), client);
+
+    res = shm_ring_create(name, params.slots, frame_bytes, ring);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    for (int slot = 0; slot < ring.slots; slot += 2)
+        std::memcpy(shm_ring_slot(ring, slot), image.data, frame_bytes);
+
+    ServeRequest request;
+    std::memset(&request, 0, sizeof(request));
+
+    request.magic     = SERVE_MAGIC;
+    request.op        = SERVE_OP_SHM_ATTACH;
+    request.input_len = (uint32_t) ring.name.size();
+
+    ServeResponse response;
+
+    if (
+        !serve_send_all(fd, &request, sizeof(request)) ||
+        !serve_send_all(fd, ring.name.data(), request.input_len) ||
+        !serve_recv_all(fd, &response, sizeof(response))
+    ) {
+        return CODE_FAILURE;
+    }
+
+    return response.status;
+}
+
+static void run_client(
+    const LoadgenParams& params,
+    int client,
+    int requests,
+    const Tensor& frame,
+    ClientResult& result
+) {
+    int fd = serve_connect(params.socket_path);
+    if (fd < 0) {
+        result.res = CODE_FAILURE;
+        return;
+    }
+
+    ShmRing ring;
+
+    if (params.shm && params.input_path.empty()) {
+        result.res = attach_ring(fd, client, params, frame, ring);
+        if (result.res != CODE_SUCCESS) {
+            shm_ring_close(ring);
+            close(fd);
+            return;
+        }
+    }
+
+    ServeRequest request;
+    fill_request(params, request);
+
+    std::vector<float> output;
+    result.latencies_ms.reserve(requests);
+
+    for (int i = 0; i < requests; i++) {
+        ServeResponse response;
+
+        // Rotate through the slot pairs as a producer would
+        int pair = ring.slots > 0 ? i % (ring.slots / 2) : 0;
+        request.input_slot  = 2 * pair;
+        request.output_slot = 2 * pair + 1;
+
+        auto t0 = Clock::now();
+
+        if (!send_request(fd, params, request, frame, output, response)) {
+            result.res = CODE_FAILURE;
+            break;
+        }
+
+        auto t1 = Clock::now();
+
+        if (response.status != CODE_SUCCESS) {
+            result.failures++;
+            continue;
+        }
+
+        result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+
+    shm_ring_close(ring);
+    close(fd);
+}
+
+int run_loadgen(const LoadgenParams& loadgen_params) {
+
+    int res = CODE_SUCCESS;
+
+    // Same frame for every request: we measure the service, not the client
+    Tensor frame;
+    if (loadgen_params.input_path.empty()) {
+        int channels = loadgen_params.color_mode == COLOR_MODE_RGB ? CHANNELS_RGB : CHANNELS_GRAYSCALE;
+        frame = Tensor(loadgen_params.frame_size, loadgen_params.frame_size, channels);
+
+        size_t count = (size_t) loadgen_params.frame_size * loadgen_params.frame_size * channels;
+        for (size_t i = 0; i < count; i++)
+            frame.data()[i] = (float) rand() / RAND_MAX;
+    }
+
+    int clients = std::max(1, std::min(loadgen_params.clients, loadgen_params.requests));
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+
+    auto t0 = Clock::now();
+
+    for (int c = 0; c < clients; c++) {
+        int requests = loadgen_params.requests / clients + (c < loadgen_params.requests % clients ? 1 : 0);
+        threads.emplace_back(run_client, std::cref(loadgen_params), c, requests, std::cref(frame), std::ref(results[c]));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    double wall_s = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::vector<double> latencies;
+    int failures = 0;
+
+    for (const auto& result : results) {
+        if (result.res != CODE_SUCCESS)
+            res = result.res;
+        failures += result.failures;
+        latencies.insert(latencies.end(), result.latencies_ms.begin(), result.latencies_ms.end());
+    }
+
+    if (res != CODE_SUCCESS)
+        print_err("Lost connection to the server (is it running?)", res);
+
+    BenchmarkStats stats;
+    if (compute_benchmark_stats(latencies, stats) != CODE_SUCCESS) {
+        print_err("No request succeeded (see the server log)", CODE_FAILURE);
+        return CODE_FAILURE;
+    }
+
+    fprintf(stdout, "Requests:   %d ok, %d failed over %d client(s)\n", stats.samples, failures, clients);
+    fprintf(stdout, "Throughput: %.2lf requests/s\n", stats.samples / wall_s);
+    fprintf(stdout, "Latency (ms): min %.3lf | median %.3lf | p95 %.3lf | p99 %.3lf | max %.3lf\n",
+            stats.min, stats.median, stats.p95, stats.p99, stats.max);
+
+    return res;
+}
@@ -2,7 +2,15 @@
 #include "constants.h"
 #include "functional_test.h"
 #include "infer_test.h"
+#include "loadgen.h"
+#include "pyramid_mode.h"
+#include "roofline.h"
+#include "serve.h"
 #include "speed_test.h"
+#include "stream.h"
+#include "trace.h"
+#include "autotune.h"
+#include "tune_mode.h"
 #include "utility.h"
 
 static int read_input_and_run_functional_test() {
@@ -50,6 +58,32 @@ static int read_input_and_run_infer_test() {
     return res;
 }
 
+static int read_input_and_run_roofline() {
+
+    RooflineParams params;
+
+    return run_roofline(params);
+}
+
+static int read_input_and_run_serve() {
+
+    int res = CODE_SUCCESS;
+
+    ServeParams params;
+
+    char socket_path[MED_BUF_SIZE];
+
+    res = read_param("Socket Path", stdin, SERVE_SOCKET_PATH_DEF, socket_path, sizeof(socket_path));
+    if (res != CODE_SUCCESS) {
+        print_err("Failed to read socket path", CODE_FAILURE_READ_INPUT);
+        return res;
+    }
+
+    params.socket_path = socket_path;
+
+    return run_serve(params);
+}
+
 static int run_interactive() {
 
     int res = CODE_SUCCESS;
@@ -58,15 +92,19 @@ static int run_interactive() {
 
     int option;
 
-    OptionEntry options[3];
+    OptionEntry options[5];
     options[0].option_number = RUN_MODE_FUNCTIONAL_TEST;
     options[0].option_name   = RUN_MODE_FUNCTIONAL_TEST_STR;
     options[1].option_number = RUN_MODE_SPEED_TEST;
     options[1].option_name   = RUN_MODE_SPEED_TEST_STR;
     options[2].option_number = RUN_MODE_INFER_TEST;
     options[2].option_name   = RUN_MODE_INFER_TEST_STR;
+    options[3].option_number = RUN_MODE_ROOFLINE;
+    options[3].option_name   = RUN_MODE_ROOFLINE_STR;
+    options[4].option_number = RUN_MODE_SERVE;
+    options[4].option_name   = RUN_MODE_SERVE_STR;
 
-    res = read_option("Option", options, 3, stdin, &option_def, &option);
+    res = read_option("Option", options, 5, stdin, &option_def, &option);
     if (res != CODE_SUCCESS) {
         print_err("Failed to read option", res);
         return res;
@@ -78,6 +116,10 @@ static int run_interactive() {
         res = read_input_and_run_speed_test();
     else if (option == RUN_MODE_INFER_TEST)
         res = read_input_and_run_infer_test();
+    else if (option == RUN_MODE_ROOFLINE)
+        res = read_input_and_run_roofline();
+    else if (option == RUN_MODE_SERVE)
+        res = read_input_and_run_serve();
 
     return res;
 }
@@ -99,6 +141,12 @@ static int run_cli(int argc, char **argv) {
         return res;
     }
 
+    if (!args.trace_path.empty())
+        trace_enable(true);
+
+    if (!args.tune_cache.empty())
+        autotune_set_cache_path(args.tune_cache);
+
     if (args.run_mode == RUN_MODE_FUNCTIONAL_TEST) {
 
         FunctionalTestParams params = {
@@ -108,7 +156,9 @@ static int run_cli(int argc, char **argv) {
             args.color_mode,
             args.input, 
             args.output,
-            args.save_output
+            args.save_output,
+            args.perf_counters,
+            args.dtype
         };
 
         res = run_functional_test(params);
@@ -122,7 +172,19 @@ static int run_cli(int argc, char **argv) {
             args.color_mode,
             args.input, 
             args.output,
-            args.save_output
+            args.save_output,
+            args.warmup,
+            args.repetitions,
+            args.cpu,
+            args.report_format,
+            args.report_path,
+            args.perf_counters,
+            args.pipeline,
+            args.decode_threads,
+            args.conv_threads,
+            args.encode_threads,
+            args.queue_depth,
+            args.dtype
         };
 
         res = run_speed_test(params);
@@ -140,6 +202,98 @@ static int run_cli(int argc, char **argv) {
 
         res = run_infer_test(params);
     }
+    else if (args.run_mode == RUN_MODE_ROOFLINE) {
+
+        RooflineParams params = {
+            args.engine_mode,
+            args.kernel_size,
+            args.cpu
+        };
+
+        res = run_roofline(params);
+    }
+    else if (args.run_mode == RUN_MODE_SERVE) {
+
+        ServeParams params = {
+            args.socket_path,
+            args.conv_threads,
+            args.queue_depth,
+            args.cpu
+        };
+
+        res = run_serve(params);
+    }
+    else if (args.run_mode == RUN_MODE_LOADGEN) {
+
+        LoadgenParams params = {
+            args.socket_path,
+            args.engine_mode,
+            args.kernel_type,
+            args.kernel_size,
+            args.color_mode,
+            args.input,
+            args.output,
+            args.requests,
+            args.clients,
+            args.frame_size,
+            args.shm,
+            args.slots
+        };
+
+        res = run_loadgen(params);
+    }
+    else if (args.run_mode == RUN_MODE_STREAM) {
+
+        StreamParams params = {
+            args.engine_mode,
+            args.kernel_type,
+            args.kernel_size,
+            args.color_mode,
+            args.input,
+            args.output,
+            args.frame_width,
+            args.frame_height,
+            args.cpu
+        };
+
+        res = run_stream(params);
+    }
+    else if (args.run_mode == RUN_MODE_PYRAMID) {
+
+        PyramidParams params = {
+            args.engine_mode,
+            args.pyramid_type,
+            args.levels,
+            args.color_mode,
+            args.input,
+            args.output,
+            args.bank
+        };
+
+        res = run_pyramid(params);
+    }
+    else if (args.run_mode == RUN_MODE_TUNE) {
+
+        TuneParams params = {
+            args.kernel_type,
+            args.kernel_size,
+            args.color_mode,
+            args.input,
+            args.frame_width,
+            args.frame_height,
+            args.dtype
+        };
+
+        res = run_tune(params);
+    }
+
+    if (!args.trace_path.empty()) {
+        trace_enable(false);
+
+        int trace_res = trace_write_chrome_json(args.trace_path.c_str());
+        if (res == CODE_SUCCESS)
+            res = trace_res;
+    }
        
     return res;
 }
@@ -157,6 +311,8 @@ int main(int argc, char **argv) {
 
     int res = CODE_SUCCESS;
 
+    set_log_handler(stderr_log_handler, nullptr);
+
     if (argc == 1) res = run_interactive();
     else           res = run_cli(argc, argv);
 
@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+#include "constants.h"
+#include "utility.h"
+
+static const char *event_names[PERF_EVENT_COUNT] = {
+    "cycles",
+    "instructions",
+    "L1D read misses",
+    "LLC misses",
+    "branch misses",
+};
+
+static void get_event_config(int event, perf_event_attr& attr) {
+    switch (event) {
+        case PERF_EVENT_CYCLES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+
+        case PERF_EVENT_INSTRUCTIONS:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+
+        case PERF_EVENT_L1D_MISSES:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+
+        case PERF_EVENT_LLC_MISSES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+
+        default:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+}
+
+static int open_event(int event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+
+    get_event_config(event, attr);
+
+    attr.size           = sizeof(attr);
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perf_counters_open(PerfCounters& counters) {
+
+    counters.available = false;
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        counters.fds[e] = open_event(e);
+        if (counters.fds[e] >= 0)
+            counters.available = true;
+    }
+
+    if (!counters.available) {
+        print_warn("Hardware performance counters are unavailable (check perf_event_paranoid or container seccomp), running without them");
+        return CODE_FAILURE_NOT_SUPPORTED;
+    }
+
+    return CODE_SUCCESS;
+}
+
+void perf_counters_close(PerfCounters& counters) {
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (counters.fds[e] >= 0)
+            close(counters.fds[e]);
+        counters.fds[e] = -1;
+    }
+
+    counters.available = false;
+}
+
+void perf_counters_start(const PerfCounters& counters) {
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (counters.fds[e] < 0)
+            continue;
+        ioctl(counters.fds[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters.fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(const PerfCounters& counters, PerfSample& sample) {
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (counters.fds[e] >= 0)
+            ioctl(counters.fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (counters.fds[e] < 0)
+            continue;
+
+        // value, time enabled, time running
+        uint64_t values[3];
+        if (read(counters.fds[e], values, sizeof(values)) != sizeof(values))
+            continue;
+
+        // Scale up when the PMU multiplexed this counter with others
+        uint64_t count = values[0];
+        if (values[2] > 0 && values[2] < values[1])
+            count = (uint64_t) ((double) count * values[1] / values[2]);
+
+        sample.counts[e] += count;
+        sample.valid[e]   = true;
+    }
+
+    sample.windows++;
+}
+
+void print_perf_report(int engine_mode, const PerfSample& sample) {
+
+    fprintf(stdout, "%s Engine: %s hardware counters over %d invocation(s)\n",
+            LOG_LEVEL_PERF, get_engine_name(engine_mode).c_str(), sample.windows);
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (sample.valid[e])
+            fprintf(stdout, "  %-16s %llu\n", event_names[e], (unsigned long long) sample.counts[e]);
+        else
+            fprintf(stdout, "  %-16s n/a\n", event_names[e]);
+    }
+
+    double cycles       = (double) sample.counts[PERF_EVENT_CYCLES];
+    double instructions = (double) sample.counts[PERF_EVENT_INSTRUCTIONS];
+
+    if (sample.valid[PERF_EVENT_CYCLES] && sample.valid[PERF_EVENT_INSTRUCTIONS] && cycles > 0)
+        fprintf(stdout, "  %-16s %.3lf\n", "IPC", instructions / cycles);
+
+    if (sample.valid[PERF_EVENT_CYCLES] && cycles > 0)
+        fprintf(stdout, "  %-16s %.3lf\n", "bytes/cycle", sample.bytes / cycles);
+}
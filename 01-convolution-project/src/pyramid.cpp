@@ -0,0 +1,429 @@
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+#include "pyramid.h"
+#include "constants.h"
+#include "tensor.h"
+#include "utility.h"
+
+// 1 4 6 4 1 in each direction sums to 16 * 16
+static constexpr float PYRAMID_NORM = 1.0f / 256.0f;
+
+// Border taps sit PYRAMID_TAPS / 2 floats before and after each row
+static constexpr int PYRAMID_PAD = PYRAMID_TAPS / 2;
+
+static inline int reflect_101(int i, int n) {
+    if (n == 1)
+        return 0;
+
+    while (i < 0 || i >= n) {
+        if (i < 0)  i = -i;
+        if (i >= n) i = 2 * (n - 1) - i;
+    }
+
+    return i;
+}
+
+static inline int round_up(int n, int multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+static inline float* plane_at(const Image& img, int c) {
+    return img.data + c * image_channel_stride(img);
+}
+
+// ==========================================================================
+// ============================== Baseline ==================================
+// ==========================================================================
+
+static void pyramid_down_baseline(
+    const float *in,
+    int in_height,
+    int in_width,
+    int in_stride,
+    float *out,
+    int out_height,
+    int out_width,
+    int out_stride
+) {
+    static constexpr float TAPS[PYRAMID_TAPS] = { 1.0f, 4.0f, 6.0f, 4.0f, 1.0f };
+
+    for (int oy = 0; oy < out_height; oy++) {
+        for (int ox = 0; ox < out_width; ox++) {
+
+            float sum = 0.0f;
+
+            for (int ky = 0; ky < PYRAMID_TAPS; ky++) {
+                int sy = reflect_101(2 * oy + ky - PYRAMID_PAD, in_height);
+
+                for (int kx = 0; kx < PYRAMID_TAPS; kx++) {
+                    int sx = reflect_101(2 * ox + kx - PYRAMID_PAD, in_width);
+                    sum += TAPS[ky] * TAPS[kx] * in[sy * in_stride + sx];
+                }
+            }
+
+            out[oy * out_stride + ox] = sum * PYRAMID_NORM;
+        }
+    }
+}
+
+// ==========================================================================
+// ================================ SIMD ====================================
+// ==========================================================================
+
+// Vertical 1 4 6 4 1 over five source rows into t[PYRAMID_PAD ...], then the
+// reflected border columns so the horizontal pass needs no bounds checks.
+static void blur_rows_vertical(
+    int engine_mode,
+    const float *r0,
+    const float *r1,
+    const float *r2,
+    const float *r3,
+    const float *r4,
+    float *t,
+    int width
+) {
+    float *dst = t + PYRAMID_PAD;
+    int x = 0;
+
+    if (engine_mode == ENGINE_MODE_AVX) {
+        const __m256 four = _mm256_set1_ps(4.0f);
+        const __m256 six  = _mm256_set1_ps(6.0f);
+
+        for (; x <= width - 8; x += 8) {
+            __m256 outer = _mm256_add_ps(_mm256_loadu_ps(&r0[x]), _mm256_loadu_ps(&r4[x]));
+            __m256 inner = _mm256_add_ps(_mm256_loadu_ps(&r1[x]), _mm256_loadu_ps(&r3[x]));
+            __m256 sum   = _mm256_add_ps(outer, _mm256_mul_ps(four, inner));
+            _mm256_storeu_ps(&dst[x], _mm256_add_ps(sum, _mm256_mul_ps(six, _mm256_loadu_ps(&r2[x]))));
+        }
+    }
+    else {
+        const __m128 four = _mm_set1_ps(4.0f);
+        const __m128 six  = _mm_set1_ps(6.0f);
+
+        for (; x <= width - 4; x += 4) {
+            __m128 outer = _mm_add_ps(_mm_loadu_ps(&r0[x]), _mm_loadu_ps(&r4[x]));
+            __m128 inner = _mm_add_ps(_mm_loadu_ps(&r1[x]), _mm_loadu_ps(&r3[x]));
+            __m128 sum   = _mm_add_ps(outer, _mm_mul_ps(four, inner));
+            _mm_storeu_ps(&dst[x], _mm_add_ps(sum, _mm_mul_ps(six, _mm_loadu_ps(&r2[x]))));
+        }
+    }
+
+    for (; x < width; x++)
+        dst[x] = (r0[x] + r4[x]) + 4.0f * (r1[x] + r3[x]) + 6.0f * r2[x];
+
+    for (int p = 1; p <= PYRAMID_PAD; p++) {
+        dst[-p]            = dst[reflect_101(-p, width)];
+        dst[width - 1 + p] = dst[reflect_101(width - 1 + p, width)];
+    }
+}
+
+// Even and odd lanes of the 2 * lanes floats at a, in order
+static inline void deinterleave_sse(const float *a, __m128& even, __m128& odd) {
+    __m128 lo = _mm_loadu_ps(a);
+    __m128 hi = _mm_loadu_ps(a + 4);
+    even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    odd  = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+static inline void deinterleave_avx(const float *a, __m256& even, __m256& odd) {
+    __m256 lo = _mm256_loadu_ps(a);
+    __m256 hi = _mm256_loadu_ps(a + 8);
+
+    // In-lane shuffles leave 64-bit pairs as lo0 hi0 lo1 hi1; swap the middle
+    __m256 e = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 o = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(e), _MM_SHUFFLE(3, 1, 2, 0)));
+    odd  = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(o), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// out[ox] = t[2ox] + 4 t[2ox + 1] + 6 t[2ox + 2] + 4 t[2ox + 3] + t[2ox + 4],
+// i.e. the horizontal taps evaluated only where the output samples them.
+// Reads up to one float past the padded row; the row buffer has slack.
+static void blur_decimate_horizontal(
+    int engine_mode,
+    const float *t,
+    float *out,
+    int out_width
+) {
+    int ox = 0;
+
+    if (engine_mode == ENGINE_MODE_AVX) {
+        const __m256 four = _mm256_set1_ps(4.0f);
+        const __m256 six  = _mm256_set1_ps(6.0f);
+        const __m256 norm = _mm256_set1_ps(PYRAMID_NORM);
+
+        for (; ox <= out_width - 8; ox += 8) {
+            const float *base = t + 2 * ox;
+            __m256 e0, o0, e1, o1, e2, unused;
+
+            deinterleave_avx(base,     e0, o0);
+            deinterleave_avx(base + 2, e1, o1);
+            deinterleave_avx(base + 4, e2, unused);
+
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(e0, e2), _mm256_mul_ps(four, _mm256_add_ps(o0, o1)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(six, e1));
+            _mm256_storeu_ps(&out[ox], _mm256_mul_ps(sum, norm));
+        }
+    }
+    else {
+        const __m128 four = _mm_set1_ps(4.0f);
+        const __m128 six  = _mm_set1_ps(6.0f);
+        const __m128 norm = _mm_set1_ps(PYRAMID_NORM);
+
+        for (; ox <= out_width - 4; ox += 4) {
+            const float *base = t + 2 * ox;
+            __m128 e0, o0, e1, o1, e2, unused;
+
+            deinterleave_sse(base,     e0, o0);
+            deinterleave_sse(base + 2, e1, o1);
+            deinterleave_sse(base + 4, e2, unused);
+
+            __m128 sum = _mm_add_ps(_mm_add_ps(e0, e2), _mm_mul_ps(four, _mm_add_ps(o0, o1)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(six, e1));
+            _mm_storeu_ps(&out[ox], _mm_mul_ps(sum, norm));
+        }
+    }
+
+    for (; ox < out_width; ox++) {
+        const float *p = t + 2 * ox;
+        out[ox] = ((p[0] + p[4]) + 4.0f * (p[1] + p[3]) + 6.0f * p[2]) * PYRAMID_NORM;
+    }
+}
+
+// Fused blur and stride-2 decimation: the vertical taps run only for rows the
+// decimation keeps and the horizontal taps only for kept columns, so nothing
+// is filtered and then thrown away.
+static void pyramid_down_simd(
+    int engine_mode,
+    const float *in,
+    int in_height,
+    int in_width,
+    int in_stride,
+    float *out,
+    int out_height,
+    int out_width,
+    int out_stride,
+    float *t
+) {
+    for (int oy = 0; oy < out_height; oy++) {
+        const float *r[PYRAMID_TAPS];
+        for (int k = 0; k < PYRAMID_TAPS; k++)
+            r[k] = in + (size_t) reflect_101(2 * oy + k - PYRAMID_PAD, in_height) * in_stride;
+
+        blur_rows_vertical(engine_mode, r[0], r[1], r[2], r[3], r[4], t, in_width);
+        blur_decimate_horizontal(engine_mode, t, out + (size_t) oy * out_stride, out_width);
+    }
+}
+
+// ==========================================================================
+// ============================== Laplacian =================================
+// ==========================================================================
+
+// fine -= expand(coarse): the same binomial kernel scaled by 4, so even
+// positions weigh 1 6 1 / 8 and odd positions 4 4 / 8 per axis; coarse
+// indices past the edge are clamped. v holds one vertically expanded row.
+static void subtract_expanded(
+    const float *coarse,
+    int coarse_height,
+    int coarse_width,
+    int coarse_stride,
+    float *fine,
+    int fine_height,
+    int fine_width,
+    int fine_stride,
+    float *v
+) {
+    const int last_y = coarse_height - 1;
+    const int last_x = coarse_width - 1;
+
+    for (int y = 0; y < fine_height; y++) {
+        const int i = y / 2;
+
+        const float *c0 = coarse + (size_t) std::max(i - 1, 0) * coarse_stride;
+        const float *c1 = coarse + (size_t) i * coarse_stride;
+        const float *c2 = coarse + (size_t) std::min(i + 1, last_y) * coarse_stride;
+
+        if (y % 2 == 0) {
+            for (int x = 0; x < coarse_width; x++)
+                v[x] = (c0[x] + 6.0f * c1[x] + c2[x]) * 0.125f;
+        }
+        else {
+            for (int x = 0; x < coarse_width; x++)
+                v[x] = (c1[x] + c2[x]) * 0.5f;
+        }
+
+        float *dst = fine + (size_t) y * fine_stride;
+
+        for (int x = 0; x < fine_width; x++) {
+            const int j = x / 2;
+
+            float up = (x % 2 == 0)
+                ? (v[std::max(j - 1, 0)] + 6.0f * v[j] + v[std::min(j + 1, last_x)]) * 0.125f
+                : (v[j] + v[std::min(j + 1, last_x)]) * 0.5f;
+
+            dst[x] -= up;
+        }
+    }
+}
+
+// ==========================================================================
+// ================================ Entry ===================================
+// ==========================================================================
+
+int pyramid_reserve(
+    Pyramid& pyramid,
+    int height,
+    int width,
+    int channels,
+    int levels
+) {
+    if (
+        height <= 0 || width <= 0 || channels <= 0 ||
+        levels < 1 || levels > PYRAMID_MAX_LEVELS
+    ) {
+        print_err("Invalid pyramid geometry", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    pyramid.levels.clear();
+
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    int h = height;
+    int w = width;
+
+    for (int l = 0; l < levels; l++) {
+        Image level;
+        level.height         = h;
+        level.width          = w;
+        level.channels       = channels;
+        level.row_stride     = round_up(w, PYRAMID_ROW_ALIGN);
+        level.channel_stride = h * level.row_stride;
+
+        offsets.push_back(total);
+        total += (size_t) level.channel_stride * channels;
+
+        pyramid.levels.push_back(level);
+
+        if (h == 1 && w == 1)
+            break;
+
+        h = (h + 1) / 2;
+        w = (w + 1) / 2;
+    }
+
+    const Image& top = pyramid.levels[0];
+
+    size_t scratch_at = total;
+    total += (size_t) top.channel_stride * channels;
+
+    // Padded vertical-pass row plus slack for the last SIMD block's overread
+    size_t rows_at = total;
+    total += round_up(width + 2 * PYRAMID_PAD, PYRAMID_ROW_ALIGN) + PYRAMID_ROW_ALIGN;
+
+    if (pyramid.arena_floats < total) {
+        tensor_free(pyramid.arena);
+        pyramid.arena        = tensor_alloc(total);
+        pyramid.arena_floats = total;
+    }
+
+    for (size_t l = 0; l < pyramid.levels.size(); l++)
+        pyramid.levels[l].data = pyramid.arena + offsets[l];
+
+    pyramid.scratch      = top;
+    pyramid.scratch.data = pyramid.arena + scratch_at;
+    pyramid.rows         = pyramid.arena + rows_at;
+
+    return CODE_SUCCESS;
+}
+
+int build_pyramid(
+    int engine_mode,
+    int pyramid_type,
+    const Image& input,
+    int levels,
+    Pyramid& pyramid
+) {
+    if (!input.data) {
+        print_err("Invalid pyramid input", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (
+        engine_mode != ENGINE_MODE_BASELINE &&
+        engine_mode != ENGINE_MODE_SSE &&
+        engine_mode != ENGINE_MODE_AVX
+    ) {
+        print_err("Invalid engine mode", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (pyramid_type != PYRAMID_TYPE_GAUSSIAN && pyramid_type != PYRAMID_TYPE_LAPLACIAN) {
+        print_err("Invalid pyramid type", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    int res = pyramid_reserve(pyramid, input.height, input.width, input.channels, levels);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    const Image& base = pyramid.levels[0];
+
+    for (int c = 0; c < input.channels; c++) {
+        for (int y = 0; y < input.height; y++) {
+            std::memcpy(
+                plane_at(base, c) + (size_t) y * base.row_stride,
+                plane_at(input, c) + (size_t) y * image_row_stride(input),
+                input.width * sizeof(float));
+        }
+    }
+
+    for (size_t l = 0; l + 1 < pyramid.levels.size(); l++) {
+        const Image& fine   = pyramid.levels[l];
+        const Image& coarse = pyramid.levels[l + 1];
+
+        for (int c = 0; c < fine.channels; c++) {
+            if (engine_mode == ENGINE_MODE_BASELINE)
+                pyramid_down_baseline(
+                    plane_at(fine, c), fine.height, fine.width, fine.row_stride,
+                    plane_at(coarse, c), coarse.height, coarse.width, coarse.row_stride);
+            else
+                pyramid_down_simd(
+                    engine_mode,
+                    plane_at(fine, c), fine.height, fine.width, fine.row_stride,
+                    plane_at(coarse, c), coarse.height, coarse.width, coarse.row_stride,
+                    pyramid.rows);
+        }
+    }
+
+    if (pyramid_type == PYRAMID_TYPE_GAUSSIAN)
+        return CODE_SUCCESS;
+
+    // Fine to coarse (l = 0 upward): level l is replaced by its band while
+    // G(l + 1), which it is built from, has not been touched yet
+    for (size_t l = 0; l + 1 < pyramid.levels.size(); l++) {
+        const Image& fine   = pyramid.levels[l];
+        const Image& coarse = pyramid.levels[l + 1];
+
+        for (int c = 0; c < fine.channels; c++) {
+            subtract_expanded(
+                plane_at(coarse, c), coarse.height, coarse.width, coarse.row_stride,
+                plane_at(fine, c), fine.height, fine.width, fine.row_stride,
+                pyramid.rows);
+        }
+    }
+
+    return CODE_SUCCESS;
+}
+
+void free_pyramid(Pyramid& pyramid) {
+    tensor_free(pyramid.arena);
+
+    pyramid.levels.clear();
+    pyramid.scratch      = Image();
+    pyramid.rows         = nullptr;
+    pyramid.arena        = nullptr;
+    pyramid.arena_floats = 0;
+}
@@ -0,0 +1,177 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "pyramid_mode.h"
+#include "pyramid.h"
+#include "conv2d.h"
+#include "constants.h"
+#include "io.h"
+#include "kernel_factory.h"
+#include "tensor.h"
+#include "utility.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ms_between(Clock::time_point t0, Clock::time_point t1) {
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static std::string level_filename(
+    const std::string& output,
+    int level,
+    const std::string& suffix
+) {
+    std::filesystem::path path(output);
+
+    std::string name = path.stem().string() + "_l" + std::to_string(level);
+    if (!suffix.empty())
+        name += "_" + suffix;
+
+    return (path.parent_path() / (name + path.extension().string())).string();
+}
+
+// Laplacian bands are signed; shift them by 0.5 into scratch so mid grey
+// means zero when written as an 8-bit image
+static int save_level(
+    const PyramidParams& params,
+    const Pyramid& pyramid,
+    int level
+) {
+    const Image& img = pyramid.levels[level];
+    std::string filename = level_filename(params.output, level, "");
+
+    bool band =
+        params.pyramid_type == PYRAMID_TYPE_LAPLACIAN &&
+        level + 1 < (int) pyramid.levels.size();
+
+    if (!band)
+        return save_image_as(params.color_mode, filename.c_str(), img);
+
+    Image shifted = pyramid.scratch;
+    shifted.height = img.height;
+    shifted.width  = img.width;
+
+    for (int c = 0; c < img.channels; c++) {
+        for (int y = 0; y < img.height; y++) {
+            const float *src = img.data + c * image_channel_stride(img) + y * image_row_stride(img);
+            float *dst = shifted.data + c * image_channel_stride(shifted) + y * image_row_stride(shifted);
+
+            for (int x = 0; x < img.width; x++)
+                dst[x] = src[x] + 0.5f;
+        }
+    }
+
+    return save_image_as(params.color_mode, filename.c_str(), shifted);
+}
+
+int run_pyramid(const PyramidParams& pyramid_params) {
+
+    int res = CODE_SUCCESS;
+
+    const bool save_output = !pyramid_params.output.empty();
+
+    Image input;
+    Pyramid pyramid;
+    std::vector<KernelRef> bank;
+
+    Clock::time_point t0, t1;
+    double build_ms = 0.0;
+    double bank_ms  = 0.0;
+    int    convs    = 0;
+
+    res = load_image_as(pyramid_params.color_mode, pyramid_params.input, input);
+    if (res != CODE_SUCCESS)
+        goto _exit;
+
+    for (const FilterSpec& spec : pyramid_params.bank) {
+        KernelRef ref;
+        res = get_kernel_ref(spec.kernel_type, spec.kernel_size, KERNEL_SIGMA_DEF, ref);
+        if (res != CODE_SUCCESS) {
+            print_err("Failed to create filter bank kernel", res);
+            goto _exit;
+        }
+        bank.push_back(ref);
+    }
+
+    t0 = Clock::now();
+    res = build_pyramid(
+            pyramid_params.engine_mode,
+            pyramid_params.pyramid_type,
+            input,
+            pyramid_params.levels,
+            pyramid);
+    t1 = Clock::now();
+
+    if (res != CODE_SUCCESS) {
+        print_err("Failed to build pyramid", res);
+        goto _exit;
+    }
+
+    build_ms = ms_between(t0, t1);
+
+    for (int l = 0; l < (int) pyramid.levels.size(); l++) {
+        const Image& level = pyramid.levels[l];
+
+        if (save_output) {
+            res = save_level(pyramid_params, pyramid, l);
+            if (res != CODE_SUCCESS)
+                goto _exit;
+        }
+
+        for (size_t f = 0; f < bank.size(); f++) {
+            Conv2DParams params;
+            params.image  = level;
+            params.kernel = bank[f]->kernel;
+            params.stride = 1;
+
+            if (level.height < params.kernel.size || level.width < params.kernel.size)
+                continue;
+
+            // Filter results share the scratch planes, one at a time
+            Image output = pyramid.scratch;
+            conv2d_output_size(params, output.height, output.width);
+
+            t0 = Clock::now();
+            res = conv2d_channels_into(pyramid_params.engine_mode, params, output);
+            t1 = Clock::now();
+
+            if (res != CODE_SUCCESS) {
+                print_err("Failed to run filter bank", res);
+                goto _exit;
+            }
+
+            bank_ms += ms_between(t0, t1);
+            convs++;
+
+            if (save_output) {
+                std::string filename = level_filename(pyramid_params.output, l, pyramid_params.bank[f].name);
+                res = save_image_as(pyramid_params.color_mode, filename.c_str(), output);
+                if (res != CODE_SUCCESS)
+                    goto _exit;
+            }
+        }
+    }
+
+    fprintf(stdout, "Engine:     %s\n", get_engine_name(pyramid_params.engine_mode).c_str());
+    fprintf(stdout, "Pyramid:    %s, %zu levels\n",
+        pyramid_params.pyramid_type == PYRAMID_TYPE_LAPLACIAN
+            ? PYRAMID_TYPE_LAPLACIAN_STR
+            : PYRAMID_TYPE_GAUSSIAN_STR,
+        pyramid.levels.size());
+
+    for (size_t l = 0; l < pyramid.levels.size(); l++)
+        fprintf(stdout, "  Level %zu:  %d x %d\n", l, pyramid.levels[l].width, pyramid.levels[l].height);
+
+    fprintf(stdout, "%s Pyramid build took %lf ms\n", LOG_LEVEL_TIMING, build_ms);
+
+    if (!bank.empty())
+        fprintf(stdout, "%s Filter bank: %d convolutions took %lf ms\n", LOG_LEVEL_TIMING, convs, bank_ms);
+
+_exit:
+    free_pyramid(pyramid);
+    tensor_free(input.data);
+
+    return res;
+}
@@ -0,0 +1,262 @@
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+
+#include "resize.h"
+#include "constants.h"
+#include "tensor.h"
+#include "utility.h"
+
+// ==========================================================================
+// ============================== Baseline ==================================
+// ==========================================================================
+
+static void resize_baseline(
+    const float *in,
+    int in_height,
+    int in_width,
+    int in_stride,
+    float *out,
+    int out_height,
+    int out_width,
+    int out_stride
+) {
+    float scale_x = static_cast<float>(in_width)  / out_width;
+    float scale_y = static_cast<float>(in_height) / out_height;
+
+    for (int y = 0; y < out_height; y++) {
+        for (int x = 0; x < out_width; x++) {
+
+            // PIL coordinate transform
+            float src_x = (x + 0.5f) * scale_x - 0.5f;
+            float src_y = (y + 0.5f) * scale_y - 0.5f;
+
+            int x0 = static_cast<int>(floor(src_x));
+            int y0 = static_cast<int>(floor(src_y));
+            int x1 = x0 + 1;
+            int y1 = y0 + 1;
+
+            // Clamp
+            x0 = std::max(0, std::min(x0, in_width - 1));
+            x1 = std::max(0, std::min(x1, in_width - 1));
+            y0 = std::max(0, std::min(y0, in_height - 1));
+            y1 = std::max(0, std::min(y1, in_height - 1));
+
+            float dx = src_x - x0;
+            float dy = src_y - y0;
+
+            float v00 = in[y0 * in_stride + x0];
+            float v01 = in[y0 * in_stride + x1];
+            float v10 = in[y1 * in_stride + x0];
+            float v11 = in[y1 * in_stride + x1];
+
+            // Bilinear interpolation
+            float value =
+                (1 - dx) * (1 - dy) * v00 +
+                dx       * (1 - dy) * v01 +
+                (1 - dx) * dy       * v10 +
+                dx       * dy       * v11;
+
+            out[y * out_stride + x] = value;
+        }
+    }
+}
+
+// ==========================================================================
+// ================================ SIMD ====================================
+// ==========================================================================
+
+void build_resize_axis(int in_size, int out_size, ResizeAxis& axis) {
+    float scale = static_cast<float>(in_size) / out_size;
+
+    axis.i0.resize(out_size);
+    axis.i1.resize(out_size);
+    axis.w.resize(out_size);
+
+    for (int o = 0; o < out_size; o++) {
+        float src = (o + 0.5f) * scale - 0.5f;
+
+        int a = static_cast<int>(floor(src));
+        int b = a + 1;
+
+        a = std::max(0, std::min(a, in_size - 1));
+        b = std::max(0, std::min(b, in_size - 1));
+
+        axis.i0[o] = a;
+        axis.i1[o] = b;
+        axis.w[o]  = src - a;
+    }
+}
+
+static void interpolate_row_scalar(const float *src, const ResizeAxis& xs, float *dst, int from, int width) {
+    for (int x = from; x < width; x++) {
+        float v0 = src[xs.i0[x]];
+        float v1 = src[xs.i1[x]];
+        dst[x] = v0 + xs.w[x] * (v1 - v0);
+    }
+}
+
+static void interpolate_row_avx(const float *src, const ResizeAxis& xs, float *dst, int width) {
+    constexpr int AVX_FLOATS = 8;
+
+    int x = 0;
+    for (; x <= width - AVX_FLOATS; x += AVX_FLOATS) {
+        __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&xs.i0[x]));
+        __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&xs.i1[x]));
+
+        __m256 v0 = _mm256_i32gather_ps(src, i0, sizeof(float));
+        __m256 v1 = _mm256_i32gather_ps(src, i1, sizeof(float));
+        __m256 w  = _mm256_loadu_ps(&xs.w[x]);
+
+        _mm256_storeu_ps(&dst[x], _mm256_add_ps(v0, _mm256_mul_ps(w, _mm256_sub_ps(v1, v0))));
+    }
+
+    interpolate_row_scalar(src, xs, dst, x, width);
+}
+
+static void blend_rows_sse(const float *top, const float *bottom, float wy, float *out, int width) {
+    constexpr int SSE_FLOATS = 4;
+
+    __m128 w = _mm_set1_ps(wy);
+
+    int x = 0;
+    for (; x <= width - SSE_FLOATS; x += SSE_FLOATS) {
+        __m128 t = _mm_loadu_ps(&top[x]);
+        __m128 b = _mm_loadu_ps(&bottom[x]);
+        _mm_storeu_ps(&out[x], _mm_add_ps(t, _mm_mul_ps(w, _mm_sub_ps(b, t))));
+    }
+
+    for (; x < width; x++)
+        out[x] = top[x] + wy * (bottom[x] - top[x]);
+}
+
+static void blend_rows_avx(const float *top, const float *bottom, float wy, float *out, int width) {
+    constexpr int AVX_FLOATS = 8;
+
+    __m256 w = _mm256_set1_ps(wy);
+
+    int x = 0;
+    for (; x <= width - AVX_FLOATS; x += AVX_FLOATS) {
+        __m256 t = _mm256_loadu_ps(&top[x]);
+        __m256 b = _mm256_loadu_ps(&bottom[x]);
+        _mm256_storeu_ps(&out[x], _mm256_add_ps(t, _mm256_mul_ps(w, _mm256_sub_ps(b, t))));
+    }
+
+    for (; x < width; x++)
+        out[x] = top[x] + wy * (bottom[x] - top[x]);
+}
+
+// Separable pass: each needed source row is interpolated horizontally once
+// into one of two cached rows, then output rows blend the cached pair.
+// Upscaling reuses a cached row for several output rows.
+static void resize_simd(
+    int engine_mode,
+    const float *in,
+    int in_stride,
+    const ResizeAxis& xs,
+    const ResizeAxis& ys,
+    float *rows,
+    float *out,
+    int out_height,
+    int out_width,
+    int out_stride
+) {
+    float *cached[2]  = { rows, rows + out_width };
+    int cached_row[2] = { -1, -1 };
+
+    auto fetch = [&](int sy, int keep) -> const float* {
+        for (int s = 0; s < 2; s++) {
+            if (cached_row[s] == sy)
+                return cached[s];
+        }
+
+        int slot = cached_row[0] == keep ? 1 : 0;
+        const float *src = in + (size_t) sy * in_stride;
+
+        if (engine_mode == ENGINE_MODE_AVX)
+            interpolate_row_avx(src, xs, cached[slot], out_width);
+        else
+            interpolate_row_scalar(src, xs, cached[slot], 0, out_width);
+
+        cached_row[slot] = sy;
+        return cached[slot];
+    };
+
+    for (int y = 0; y < out_height; y++) {
+        int y0 = ys.i0[y];
+        int y1 = ys.i1[y];
+
+        const float *top    = fetch(y0, y1);
+        const float *bottom = fetch(y1, y0);
+
+        float *dst = out + (size_t) y * out_stride;
+
+        if (engine_mode == ENGINE_MODE_AVX)
+            blend_rows_avx(top, bottom, ys.w[y], dst, out_width);
+        else
+            blend_rows_sse(top, bottom, ys.w[y], dst, out_width);
+    }
+}
+
+// ==========================================================================
+// ================================ Entry ===================================
+// ==========================================================================
+
+int resize_channels_into(
+    int engine_mode,
+    const Image& input,
+    const Image& output
+) {
+    if (
+        !input.data || input.height <= 0 || input.width <= 0 || input.channels <= 0 ||
+        !output.data || output.height <= 0 || output.width <= 0 ||
+        output.channels < input.channels ||
+        input.dtype != DTYPE_F32 || output.dtype != DTYPE_F32
+    ) {
+        print_err("Invalid resize input or output view", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    if (
+        engine_mode != ENGINE_MODE_BASELINE &&
+        engine_mode != ENGINE_MODE_SSE &&
+        engine_mode != ENGINE_MODE_AVX
+    ) {
+        print_err("Invalid engine mode", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    const int in_stride  = image_row_stride(input);
+    const int out_stride = image_row_stride(output);
+
+    if (engine_mode == ENGINE_MODE_BASELINE) {
+        for (int c = 0; c < input.channels; c++) {
+            resize_baseline(
+                input.data + c * image_channel_stride(input),
+                input.height, input.width, in_stride,
+                output.data + c * image_channel_stride(output),
+                output.height, output.width, out_stride);
+        }
+
+        return CODE_SUCCESS;
+    }
+
+    ResizeAxis xs, ys;
+    build_resize_axis(input.width, output.width, xs);
+    build_resize_axis(input.height, output.height, ys);
+
+    float *rows = tensor_alloc((size_t) 2 * output.width);
+
+    for (int c = 0; c < input.channels; c++) {
+        resize_simd(
+            engine_mode,
+            input.data + c * image_channel_stride(input), in_stride,
+            xs, ys, rows,
+            output.data + c * image_channel_stride(output),
+            output.height, output.width, out_stride);
+    }
+
+    tensor_free(rows);
+
+    return CODE_SUCCESS;
+}
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <immintrin.h>
+#include <random>
+#include <vector>
+
+#include "roofline.h"
+#include "benchmark.h"
+#include "conv2d.h"
+#include "constants.h"
+#include "kernel_factory.h"
+#include "tensor.h"
+#include "utility.h"
+
+// Independent multiply-add chains per peak loop; enough to cover the
+// mul+add latency on both FP ports without spilling registers.
+#define PEAK_CHAINS             12
+#define PEAK_ITERATIONS   10000000
+#define PEAK_RUNS                3
+
+#define STREAM_FLOATS    (1 << 23)  // 32 MiB per array, well past the LLC
+#define STREAM_RUNS              5
+
+#define ENGINE_IMAGE_SIZE     2048
+#define ENGINE_RUNS              5
+#define ENGINE_KERNEL_SEED      42
+
+struct MachineRoofline {
+    double peak_scalar;     // GFLOP/s
+    double peak_sse;
+    double peak_avx;
+    double bandwidth;       // GB/s
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Keeps the peak loops' results observable so they are not optimized away
+static volatile float roofline_sink;
+
+static double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static double measure_peak_scalar() {
+    __m128 acc[PEAK_CHAINS];
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        acc[c] = _mm_set_ss(1.0f + c);
+
+    // acc = acc * m + a converges instead of drifting into denormals
+    const __m128 m = _mm_set_ss(0.999f);
+    const __m128 a = _mm_set_ss(0.001f);
+
+    auto t0 = Clock::now();
+
+    for (long i = 0; i < PEAK_ITERATIONS; i++) {
+        for (int c = 0; c < PEAK_CHAINS; c++)
+            acc[c] = _mm_add_ss(_mm_mul_ss(acc[c], m), a);
+    }
+
+    double seconds = seconds_since(t0);
+
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        roofline_sink += _mm_cvtss_f32(acc[c]);
+
+    return 2.0 * PEAK_CHAINS * PEAK_ITERATIONS / seconds / 1e9;
+}
+
+static double measure_peak_sse() {
+    __m128 acc[PEAK_CHAINS];
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        acc[c] = _mm_set1_ps(1.0f + c);
+
+    const __m128 m = _mm_set1_ps(0.999f);
+    const __m128 a = _mm_set1_ps(0.001f);
+
+    auto t0 = Clock::now();
+
+    for (long i = 0; i < PEAK_ITERATIONS; i++) {
+        for (int c = 0; c < PEAK_CHAINS; c++)
+            acc[c] = _mm_add_ps(_mm_mul_ps(acc[c], m), a);
+    }
+
+    double seconds = seconds_since(t0);
+
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        roofline_sink += _mm_cvtss_f32(acc[c]);
+
+    return 2.0 * 4 * PEAK_CHAINS * PEAK_ITERATIONS / seconds / 1e9;
+}
+
+static double measure_peak_avx() {
+    __m256 acc[PEAK_CHAINS];
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        acc[c] = _mm256_set1_ps(1.0f + c);
+
+    const __m256 m = _mm256_set1_ps(0.999f);
+    const __m256 a = _mm256_set1_ps(0.001f);
+
+    auto t0 = Clock::now();
+
+    for (long i = 0; i < PEAK_ITERATIONS; i++) {
+        for (int c = 0; c < PEAK_CHAINS; c++)
+            acc[c] = _mm256_add_ps(_mm256_mul_ps(acc[c], m), a);
+    }
+
+    double seconds = seconds_since(t0);
+
+    for (int c = 0; c < PEAK_CHAINS; c++)
+        roofline_sink += _mm256_cvtss_f32(acc[c]);
+
+    return 2.0 * 8 * PEAK_CHAINS * PEAK_ITERATIONS / seconds / 1e9;
+}
+
+// STREAM triad (a = b + s * c), best of STREAM_RUNS
+static double measure_bandwidth() {
+    float *a = tensor_alloc(STREAM_FLOATS);
+    float *b = tensor_alloc(STREAM_FLOATS);
+    float *c = tensor_alloc(STREAM_FLOATS);
+
+    for (int i = 0; i < STREAM_FLOATS; i++) {
+        a[i] = 0.0f;
+        b[i] = 1.0f;
+        c[i] = 2.0f;
+    }
+
+    const __m256 s = _mm256_set1_ps(3.0f);
+    double best = 0.0;
+
+    for (int run = 0; run < STREAM_RUNS; run++) {
+        auto t0 = Clock::now();
+
+        for (int i = 0; i < STREAM_FLOATS; i += 8) {
+            __m256 vb = _mm256_load_ps(b + i);
+            __m256 vc = _mm256_load_ps(c + i);
+            _mm256_store_ps(a + i, _mm256_add_ps(vb, _mm256_mul_ps(s, vc)));
+        }
+
+        double seconds = seconds_since(t0);
+        double bytes   = 3.0 * STREAM_FLOATS * sizeof(float);
+
+        best = std::max(best, bytes / seconds / 1e9);
+    }
+
+    if (a[STREAM_FLOATS / 2] != 7.0f)
+        print_warn("Bandwidth benchmark produced an unexpected result");
+
+    tensor_free(a);
+    tensor_free(b);
+    tensor_free(c);
+
+    return best;
+}
+
+// Best of PEAK_RUNS; the first run also lets the core reach its turbo clock
+static double best_of(double (*measure)()) {
+    double best = 0.0;
+    for (int run = 0; run < PEAK_RUNS; run++)
+        best = std::max(best, measure());
+    return best;
+}
+
+static double get_engine_peak(const MachineRoofline& machine, int engine_mode) {
+    switch (engine_mode) {
+        case ENGINE_MODE_SSE: return machine.peak_sse;
+        case ENGINE_MODE_AVX: return machine.peak_avx;
+        default:              return machine.peak_scalar;
+    }
+}
+
+// Arithmetic intensity against compulsory DRAM traffic: every output pixel
+// costs k*k multiply-adds, one float read (the input, halo amortized) and
+// one float written.
+static double arithmetic_intensity(int kernel_size) {
+    return 2.0 * kernel_size * kernel_size / (2.0 * sizeof(float));
+}
+
+static int measure_engine(
+    int engine_mode,
+    int kernel_size,
+    const Tensor& input,
+    double& gflops
+) {
+    int res = CODE_SUCCESS;
+
+    // Random taps of no built-in type and no symmetry, so the generic
+    // multiply-add body runs and 2*k*k FLOPs per pixel is what executes;
+    // baked (adds-only) and folded kernels would overstate GFLOP/s
+    std::mt19937 rng(ENGINE_KERNEL_SEED);
+    std::uniform_real_distribution<float> tap(-1.0f, 1.0f);
+
+    Tensor taps(kernel_size, kernel_size, 1);
+    for (int i = 0; i < kernel_size * kernel_size; i++)
+        taps.data()[i] = tap(rng);
+
+    Kernel kernel;
+    kernel.data     = taps.data();
+    kernel.type     = KERNEL_TYPE_NONE;
+    kernel.size     = kernel_size;
+    kernel.symmetry = find_kernel_symmetry(kernel.data, kernel_size);
+
+    Conv2DParams params = { input.view(), kernel, 1 };
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    Tensor output(out_height, out_width, 1);
+    std::vector<double> samples;
+
+    // One untimed pass to fault in the output pages
+    res = conv2d_channels_into(engine_mode, params, output.view());
+
+    for (int run = 0; run < ENGINE_RUNS && res == CODE_SUCCESS; run++) {
+        auto t0 = Clock::now();
+        res = conv2d_channels_into(engine_mode, params, output.view());
+        samples.push_back(seconds_since(t0));
+    }
+
+    if (res != CODE_SUCCESS)
+        return res;
+
+    std::sort(samples.begin(), samples.end());
+
+    double flop = 2.0 * kernel_size * kernel_size * out_height * out_width;
+    gflops = flop / percentile(samples, 50.0) / 1e9;
+
+    return CODE_SUCCESS;
+}
+
+int run_roofline(const RooflineParams& roofline_params) {
+
+    int res = CODE_SUCCESS;
+
+    if (roofline_params.cpu >= 0)
+        pin_to_cpu(roofline_params.cpu);
+
+    MachineRoofline machine;
+
+    fprintf(stdout, "Measuring machine roofline...\n");
+
+    machine.peak_scalar = best_of(measure_peak_scalar);
+    machine.peak_sse    = best_of(measure_peak_sse);
+    machine.peak_avx    = best_of(measure_peak_avx);
+    machine.bandwidth   = measure_bandwidth();
+
+    fprintf(stdout, "\n===== Machine =====\n");
+    fprintf(stdout, "Peak Scalar:  %8.2lf GFLOP/s (ridge %.2lf FLOP/B)\n", machine.peak_scalar, machine.peak_scalar / machine.bandwidth);
+    fprintf(stdout, "Peak SSE:     %8.2lf GFLOP/s (ridge %.2lf FLOP/B)\n", machine.peak_sse,    machine.peak_sse / machine.bandwidth);
+    fprintf(stdout, "Peak AVX:     %8.2lf GFLOP/s (ridge %.2lf FLOP/B)\n", machine.peak_avx,    machine.peak_avx / machine.bandwidth);
+    fprintf(stdout, "Bandwidth:    %8.2lf GB/s (STREAM triad)\n", machine.bandwidth);
+
+    Tensor input(ENGINE_IMAGE_SIZE, ENGINE_IMAGE_SIZE, 1);
+    for (size_t i = 0; i < (size_t) ENGINE_IMAGE_SIZE * ENGINE_IMAGE_SIZE; i++)
+        input.data()[i] = (float) rand() / RAND_MAX;
+
+    const int engine_modes[] = { ENGINE_MODE_BASELINE, ENGINE_MODE_SSE, ENGINE_MODE_AVX };
+    const int kernel_sizes[] = { KERNEL_SIZE_3, KERNEL_SIZE_5, KERNEL_SIZE_7 };
+
+    fprintf(stdout, "\n===== Engines (%dx%d image) =====\n", ENGINE_IMAGE_SIZE, ENGINE_IMAGE_SIZE);
+    fprintf(stdout, "%-9s %-7s %10s %12s %12s %8s  %s\n",
+            "Engine", "Kernel", "AI FLOP/B", "GFLOP/s", "Roof GFLOP/s", "% Roof", "Bound");
+
+    for (int engine_mode : engine_modes) {
+
+        if (roofline_params.engine_mode != ENGINE_MODE_NONE && roofline_params.engine_mode != engine_mode)
+            continue;
+
+        for (int kernel_size : kernel_sizes) {
+
+            if (roofline_params.kernel_size > 0 && roofline_params.kernel_size != kernel_size)
+                continue;
+
+            std::string engine_name = get_engine_name(engine_mode);
+
+            if (!conv2d_engine_supports(engine_mode, kernel_size)) {
+                fprintf(stdout, "%-9s %dx%-5d %10s  (falls back to baseline)\n",
+                        engine_name.c_str(), kernel_size, kernel_size, "-");
+                continue;
+            }
+
+            double gflops = 0.0;
+            res = measure_engine(engine_mode, kernel_size, input, gflops);
+            if (res != CODE_SUCCESS) {
+                print_err("Failed to measure engine", res);
+                return res;
+            }
+
+            double ai    = arithmetic_intensity(kernel_size);
+            double peak  = get_engine_peak(machine, engine_mode);
+            double roof  = std::min(peak, ai * machine.bandwidth);
+            bool   mem   = ai * machine.bandwidth < peak;
+
+            fprintf(stdout, "%-9s %dx%-5d %10.2lf %12.2lf %12.2lf %7.1lf%%  %s\n",
+                    engine_name.c_str(), kernel_size, kernel_size,
+                    ai, gflops, roof, 100.0 * gflops / roof,
+                    mem ? "memory (improve blocking/reuse)" : "compute (more SIMD helps)");
+        }
+    }
+
+    return res;
+}
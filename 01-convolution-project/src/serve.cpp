@@ -0,0 +1,571 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "serve.h"
+#include "benchmark.h"
+#include "bounded_queue.h"
+#include "conv2d.h"
+#include "constants.h"
+#include "io.h"
+#include "kernel_factory.h"
+#include "shm_ring.h"
+#include "tensor.h"
+#include "trace.h"
+#include "utility.h"
+
+// ==========================================================================
+// ============================ Socket Helpers ==============================
+// ==========================================================================
+
+bool serve_send_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *) data;
+
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+
+        p   += n;
+        len -= (size_t) n;
+    }
+
+    return true;
+}
+
+bool serve_recv_all(int fd, void *data, size_t len) {
+    char *p = (char *) data;
+
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+
+        p   += n;
+        len -= (size_t) n;
+    }
+
+    return true;
+}
+
+static bool make_socket_address(const std::string& socket_path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (socket_path.size() >= sizeof(addr.sun_path))
+        return false;
+
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+int serve_connect(const std::string& socket_path) {
+    sockaddr_un addr;
+    if (!make_socket_address(socket_path, addr))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (connect(fd, (const sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// ==========================================================================
+// ================================ Server ==================================
+// ==========================================================================
+
+static volatile sig_atomic_t serve_stop = 0;
+
+static void handle_stop_signal(int) {
+    serve_stop = 1;
+}
+
+struct ServeState {
+    // Open client connections, shut down on exit so blocked workers return
+    std::mutex connections_mutex;
+    std::set<int> connections;
+
+    std::mutex latencies_mutex;
+    std::vector<double> conv_ms;
+
+    std::atomic<long> requests { 0 };
+    std::atomic<long> failures { 0 };
+    std::atomic<long> refused  { 0 };
+};
+
+// Engine scratch owned by one connection's worker, grown on demand and reused
+// across its requests. The reentrant engine call neither allocates nor logs,
+// so workers never meet on the allocator or stderr while convolving.
+struct Workspace {
+    float *data   = nullptr;
+    size_t floats = 0;
+
+    Workspace() = default;
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+    ~Workspace() { tensor_free(data); }
+};
+
+static int convolve_into(
+    int engine_mode,
+    const Conv2DParams& params,
+    const Image& output,
+    Workspace& workspace
+) {
+    size_t needed = conv2d_workspace_size(engine_mode, params);
+
+    if (needed > workspace.floats) {
+        tensor_free(workspace.data);
+        workspace.data   = tensor_alloc(needed);
+        workspace.floats = needed;
+    }
+
+    TRACE_SCOPE("conv");
+
+    Conv2DStatus status;
+    return conv2d_channels_ws(engine_mode, params, output, workspace.data, workspace.floats, status);
+}
+
+static int convolve_request(
+    const ServeRequest& request,
+    const Image& input,
+    Tensor& output,
+    Workspace& workspace,
+    double& conv_ms
+) {
+    int res = CODE_SUCCESS;
+
+    KernelRef kernel;
+    res = get_kernel_ref(request.kernel_type, request.kernel_size, KERNEL_SIGMA_DEF, kernel);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    Conv2DParams params = { input, kernel->kernel, 1 };
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    if (out_height <= 0 || out_width <= 0)
+        return CODE_FAILURE_INVALID_ARG;
+
+    output = Tensor(out_height, out_width, input.channels);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    res = convolve_into(request.engine_mode, params, output.view(), workspace);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    conv_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    return res;
+}
+
+static bool handle_path_request(
+    int fd,
+    const ServeRequest& request,
+    Workspace& workspace,
+    ServeResponse& response
+) {
+    if (request.input_len == 0 || request.input_len >= LRG_BUF_SIZE || request.output_len >= LRG_BUF_SIZE)
+        return false;
+
+    std::string input_path (request.input_len, '\0');
+    std::string output_path(request.output_len, '\0');
+
+    if (!serve_recv_all(fd, &input_path[0], request.input_len))
+        return false;
+    if (request.output_len > 0 && !serve_recv_all(fd, &output_path[0], request.output_len))
+        return false;
+
+    Image image;
+    response.status = load_image_as(request.color_mode, input_path, image);
+    if (response.status != CODE_SUCCESS)
+        return serve_send_all(fd, &response, sizeof(response));
+
+    Tensor input = Tensor::adopt(image);
+    Tensor output;
+
+    response.status = convolve_request(request, input.view(), output, workspace, response.conv_ms);
+
+    if (response.status == CODE_SUCCESS && !output_path.empty())
+        response.status = save_image_as(request.color_mode, output_path.c_str(), output.view());
+
+    if (response.status == CODE_SUCCESS) {
+        response.height   = output.view().height;
+        response.width    = output.view().width;
+        response.channels = output.view().channels;
+    }
+
+    return serve_send_all(fd, &response, sizeof(response));
+}
+
+static bool handle_raw_request(
+    int fd,
+    const ServeRequest& request,
+    Workspace& workspace,
+    ServeResponse& response
+) {
+    if (
+        request.height <= 0 || request.width <= 0 || request.channels <= 0 ||
+        (size_t) request.height * request.width * request.channels > SERVE_MAX_FLOATS
+    ) {
+        return false;
+    }
+
+    Tensor input(request.height, request.width, request.channels);
+    size_t input_bytes = (size_t) request.height * request.width * request.channels * sizeof(float);
+
+    if (!serve_recv_all(fd, input.data(), input_bytes))
+        return false;
+
+    Tensor output;
+    response.status = convolve_request(request, input.view(), output, workspace, response.conv_ms);
+
+    if (response.status != CODE_SUCCESS)
+        return serve_send_all(fd, &response, sizeof(response));
+
+    const Image& out = output.view();
+
+    response.height   = out.height;
+    response.width    = out.width;
+    response.channels = out.channels;
+
+    size_t output_bytes = (size_t) out.height * out.width * out.channels * sizeof(float);
+
+    return serve_send_all(fd, &response, sizeof(response)) &&
+           serve_send_all(fd, out.data, output_bytes);
+}
+
+static bool handle_shm_attach(
+    int fd,
+    const ServeRequest& request,
+    ShmRing& ring,
+    ServeResponse& response
+) {
+    if (request.input_len == 0 || request.input_len >= MED_BUF_SIZE)
+        return false;
+
+    std::string name(request.input_len, '\0');
+    if (!serve_recv_all(fd, &name[0], request.input_len))
+        return false;
+
+    shm_ring_close(ring);
+
+    response.status = shm_ring_attach(name, ring);
+    if (response.status != CODE_SUCCESS)
+        print_err("Failed to attach shared memory ring", response.status);
+
+    return serve_send_all(fd, &response, sizeof(response));
+}
+
+// Convolves between two slots of the attached ring; no pixel crosses the socket
+static bool handle_shm_request(
+    int fd,
+    const ServeRequest& request,
+    const ShmRing& ring,
+    Workspace& workspace,
+    ServeResponse& response
+) {
+    float *input_data  = shm_ring_slot(ring, request.input_slot);
+    float *output_data = shm_ring_slot(ring, request.output_slot);
+
+    size_t input_floats = (size_t) request.height * request.width * request.channels;
+
+    if (
+        !input_data || !output_data || request.input_slot == request.output_slot ||
+        request.height <= 0 || request.width <= 0 || request.channels <= 0 ||
+        input_floats * sizeof(float) > ring.slot_bytes
+    ) {
+        response.status = CODE_FAILURE_INVALID_ARG;
+        return serve_send_all(fd, &response, sizeof(response));
+    }
+
+    KernelRef kernel;
+    response.status = get_kernel_ref(request.kernel_type, request.kernel_size, KERNEL_SIGMA_DEF, kernel);
+    if (response.status != CODE_SUCCESS)
+        return serve_send_all(fd, &response, sizeof(response));
+
+    Image input = { input_data, request.height, request.width, request.channels };
+    Conv2DParams params = { input, kernel->kernel, 1 };
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    if (
+        out_height <= 0 || out_width <= 0 ||
+        (size_t) out_height * out_width * request.channels * sizeof(float) > ring.slot_bytes
+    ) {
+        response.status = CODE_FAILURE_INVALID_ARG;
+        return serve_send_all(fd, &response, sizeof(response));
+    }
+
+    Image output = { output_data, out_height, out_width, request.channels };
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    response.status = convolve_into(request.engine_mode, params, output, workspace);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    response.conv_ms  = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    response.height   = out_height;
+    response.width    = out_width;
+    response.channels = request.channels;
+
+    return serve_send_all(fd, &response, sizeof(response));
+}
+
+// Serves requests on one connection until the client hangs up or sends
+// something malformed; there is no way to resynchronize a broken stream.
+static void handle_connection(ServeState& state, int fd) {
+
+    ServeRequest request;
+    ShmRing ring;
+    Workspace workspace;
+
+    while (serve_recv_all(fd, &request, sizeof(request))) {
+
+        if (request.magic != SERVE_MAGIC)
+            break;
+
+        ServeResponse response;
+        std::memset(&response, 0, sizeof(response));
+        response.magic = SERVE_MAGIC;
+
+        bool ok = false;
+
+        if (request.op == SERVE_OP_PATH)
+            ok = handle_path_request(fd, request, workspace, response);
+        else if (request.op == SERVE_OP_RAW)
+            ok = handle_raw_request(fd, request, workspace, response);
+        else if (request.op == SERVE_OP_SHM_ATTACH) {
+            ok = handle_shm_attach(fd, request, ring, response);
+            if (ok)
+                continue;
+        }
+        else if (request.op == SERVE_OP_SHM)
+            ok = handle_shm_request(fd, request, ring, workspace, response);
+
+        if (!ok)
+            break;
+
+        state.requests++;
+
+        if (response.status != CODE_SUCCESS) {
+            state.failures++;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(state.latencies_mutex);
+        state.conv_ms.push_back(response.conv_ms);
+    }
+
+    shm_ring_close(ring);
+}
+
+static void print_serve_summary(ServeState& state) {
+
+    fprintf(stdout, "Served %ld request(s), %ld failed, %ld connection(s) refused\n",
+            state.requests.load(), state.failures.load(), state.refused.load());
+
+    BenchmarkStats stats;
+    if (compute_benchmark_stats(state.conv_ms, stats) != CODE_SUCCESS)
+        return;
+
+    fprintf(stdout, "Engine time (ms): median %.3lf | p95 %.3lf | p99 %.3lf | max %.3lf\n",
+            stats.median, stats.p95, stats.p99, stats.max);
+}
+
+// A socket file left by a previous run would make bind() fail. Only a socket
+// nobody listens on is removed: never a regular file, never a live server.
+static bool remove_stale_socket(const std::string& socket_path, const sockaddr_un& addr) {
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) != 0) {
+        if (errno == ENOENT)
+            return true;
+
+        print_err("Failed to check socket path", CODE_FAILURE);
+        return false;
+    }
+
+    if (!S_ISSOCK(st.st_mode)) {
+        print_err("Socket path exists and is not a socket", CODE_FAILURE_INVALID_ARG);
+        return false;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        print_err("Failed to create socket", CODE_FAILURE);
+        return false;
+    }
+
+    int connected = connect(probe, (const sockaddr *) &addr, sizeof(addr));
+    int probe_errno = errno;
+    close(probe);
+
+    if (connected == 0) {
+        print_err("Another server is already serving on this socket", CODE_FAILURE);
+        return false;
+    }
+
+    if (probe_errno != ECONNREFUSED) {
+        print_err("Failed to probe existing socket", CODE_FAILURE);
+        return false;
+    }
+
+    unlink(socket_path.c_str());
+    return true;
+}
+
+static int open_listen_socket(const std::string& socket_path) {
+    sockaddr_un addr;
+    if (!make_socket_address(socket_path, addr)) {
+        print_err("Socket path is too long", CODE_FAILURE_INVALID_ARG);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        print_err("Failed to create socket", CODE_FAILURE);
+        return -1;
+    }
+
+    if (!remove_stale_socket(socket_path, addr)) {
+        close(fd);
+        return -1;
+    }
+
+    if (bind(fd, (const sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        print_err("Failed to bind socket", CODE_FAILURE);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int run_serve(const ServeParams& serve_params) {
+
+    int res = CODE_SUCCESS;
+
+    if (serve_params.cpu >= 0)
+        pin_to_cpu(serve_params.cpu);
+
+    int listen_fd = open_listen_socket(serve_params.socket_path);
+    if (listen_fd < 0)
+        return CODE_FAILURE;
+
+    serve_stop = 0;
+    signal(SIGINT,  handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+
+    ServeState state;
+    BoundedQueue<int> pending(serve_params.queue_depth);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < serve_params.workers; t++) {
+        workers.emplace_back([&]() {
+            int fd;
+            while (pending.pop(fd)) {
+                handle_connection(state, fd);
+
+                {
+                    std::lock_guard<std::mutex> lock(state.connections_mutex);
+                    state.connections.erase(fd);
+                }
+
+                close(fd);
+            }
+        });
+    }
+
+    fprintf(stdout, "Serving on %s with %d worker(s), Ctrl+C to stop\n",
+            serve_params.socket_path.c_str(), serve_params.workers);
+    fflush(stdout);
+
+    pollfd pfd = { listen_fd, POLLIN, 0 };
+
+    while (!serve_stop) {
+
+        if (poll(&pfd, 1, SERVE_POLL_MS) <= 0)
+            continue;
+
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+
+        {
+            std::lock_guard<std::mutex> lock(state.connections_mutex);
+            state.connections.insert(fd);
+        }
+
+        // Workers keep a connection until the client hangs up, so a full
+        // queue can stay full; refuse rather than block and miss serve_stop
+        if (!pending.try_push(fd)) {
+            {
+                std::lock_guard<std::mutex> lock(state.connections_mutex);
+                state.connections.erase(fd);
+            }
+
+            close(fd);
+            state.refused++;
+        }
+    }
+
+    // Wake workers blocked on idle keep-alive connections; connections also
+    // holds the queued ones
+    {
+        std::lock_guard<std::mutex> lock(state.connections_mutex);
+        for (int fd : state.connections)
+            shutdown(fd, SHUT_RDWR);
+    }
+
+    // Queued connections are closed unserved
+    pending.close();
+
+    int queued_fd;
+    while (pending.pop(queued_fd)) {
+        {
+            std::lock_guard<std::mutex> lock(state.connections_mutex);
+            state.connections.erase(queued_fd);
+        }
+
+        close(queued_fd);
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    close(listen_fd);
+    unlink(serve_params.socket_path.c_str());
+
+    print_serve_summary(state);
+
+    return res;
+}
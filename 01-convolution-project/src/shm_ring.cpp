@@ -0,0 +1,130 @@
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+#include "constants.h"
+#include "utility.h"
+
+// The header gets a whole alignment unit so slot 0 starts aligned
+static size_t slots_offset() {
+    return MEMORY_ALIGNMENT;
+}
+
+static size_t round_up(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+int shm_ring_create(
+    const std::string& name,
+    int slots,
+    size_t slot_bytes,
+    ShmRing& ring
+) {
+    if (slots <= 0 || slot_bytes == 0) {
+        print_err("Invalid shared memory ring geometry", CODE_FAILURE_INVALID_ARG);
+        return CODE_FAILURE_INVALID_ARG;
+    }
+
+    slot_bytes = round_up(slot_bytes, MEMORY_ALIGNMENT);
+    size_t size = slots_offset() + slot_bytes * slots;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        print_err("Failed to create shared memory object", CODE_FAILURE);
+        return CODE_FAILURE;
+    }
+
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        print_err("Failed to size shared memory object", CODE_FAILURE);
+        return CODE_FAILURE;
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        print_err("Failed to map shared memory object", CODE_FAILURE);
+        return CODE_FAILURE;
+    }
+
+    ShmRingHeader *header = (ShmRingHeader *) base;
+    header->magic      = SERVE_MAGIC;
+    header->slots      = slots;
+    header->slot_bytes = slot_bytes;
+
+    ring.name       = name;
+    ring.base       = base;
+    ring.size       = size;
+    ring.slots      = slots;
+    ring.slot_bytes = slot_bytes;
+    ring.owner      = true;
+
+    return CODE_SUCCESS;
+}
+
+int shm_ring_attach(
+    const std::string& name,
+    ShmRing& ring
+) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return CODE_FAILURE_FILE_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < slots_offset()) {
+        close(fd);
+        return CODE_FAILURE_INVALID_INPUT;
+    }
+
+    size_t size = (size_t) st.st_size;
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return CODE_FAILURE;
+
+    // Never trust the header beyond what the object actually holds
+    const ShmRingHeader *header = (const ShmRingHeader *) base;
+    if (
+        header->magic != SERVE_MAGIC || header->slots <= 0 ||
+        header->slot_bytes == 0 || header->slot_bytes % MEMORY_ALIGNMENT != 0 ||
+        header->slot_bytes > (size - slots_offset()) / header->slots
+    ) {
+        munmap(base, size);
+        return CODE_FAILURE_INVALID_INPUT;
+    }
+
+    ring.name       = name;
+    ring.base       = base;
+    ring.size       = size;
+    ring.slots      = header->slots;
+    ring.slot_bytes = header->slot_bytes;
+    ring.owner      = false;
+
+    return CODE_SUCCESS;
+}
+
+void shm_ring_close(ShmRing& ring) {
+    if (ring.base)
+        munmap(ring.base, ring.size);
+
+    if (ring.owner)
+        shm_unlink(ring.name.c_str());
+
+    ring = ShmRing();
+}
+
+float* shm_ring_slot(const ShmRing& ring, int slot) {
+    if (!ring.base || slot < 0 || slot >= ring.slots)
+        return nullptr;
+
+    return (float *) ((char *) ring.base + slots_offset() + ring.slot_bytes * slot);
+}
@@ -1,13 +1,21 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <filesystem>
+#include <thread>
 #include <vector>
 
+#include "benchmark.h"
+#include "bounded_queue.h"
 #include "conv2d.h"
 #include "io.h"
 #include "speed_test.h"
+#include "tensor.h"
+#include "trace.h"
 #include "constants.h"
 #include "kernel_factory.h"
+#include "perf_counters.h"
 #include "utility.h"
 
 int read_speed_test_params(SpeedTestParams& speed_test_params) {
@@ -143,12 +151,18 @@ static int load_image_paths(
     return CODE_SUCCESS;
 }
 
-
+// Decoders take paths through an atomic index and write into the slot of
+// that index, so images keep the sorted order of load_image_paths() however
+// the decodes interleave. Unreadable files are skipped, as before.
 static int load_images(
     int color_mode,
+    int dtype,
     const std::string& dir, 
-    std::vector<Image>& images
+    int threads,
+    std::vector<Tensor>& images
 ) {
+    TRACE_SCOPE("load images");
+
     int res = CODE_SUCCESS;
     
     images.clear();
@@ -161,26 +175,46 @@ static int load_images(
         return CODE_FAILURE;
     }
 
-    for (auto& image_path : image_paths) {
-        Image image;
-        
-        if (color_mode == COLOR_MODE_GRAYSCALE)
-            res = load_grayscale_image(
-                    image_path.c_str(), 
-                    image);
-        
-        if (color_mode == COLOR_MODE_RGB) 
-            res = load_rgb_image(
-                    image_path.c_str(), 
-                    image);
+    std::vector<Tensor> slots(image_paths.size());
 
-        if (res != CODE_SUCCESS) {
-            std::string err_msg = "Failed to load image: " + image_path;
-            print_err(err_msg.c_str(), res);
-            continue;
+    std::atomic<size_t> next_path(0);
+    std::atomic<int>    error(CODE_SUCCESS);
+
+    auto decoder = [&]() {
+        size_t index;
+        while ((index = next_path++) < image_paths.size() && error == CODE_SUCCESS) {
+            Image image;
+            if (load_image_as(color_mode, image_paths[index], image) != CODE_SUCCESS)
+                continue;
+
+            slots[index] = Tensor::adopt(image);
+
+            int convert_res = slots[index].convert_to(dtype);
+            if (convert_res != CODE_SUCCESS) {
+                int expected = CODE_SUCCESS;
+                error.compare_exchange_strong(expected, convert_res);
+            }
         }
+    };
+
+    threads = std::max(1, (int) std::min((size_t) threads, image_paths.size()));
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(decoder);
 
-        images.push_back(image);
+    decoder();
+
+    for (auto& thread : pool)
+        thread.join();
+
+    res = error.load();
+    if (res != CODE_SUCCESS)
+        return res;
+
+    for (auto& slot : slots) {
+        if (!slot.empty())
+            images.push_back(std::move(slot));
     }
 
     return res;
@@ -189,35 +223,308 @@ static int load_images(
 static int save_images(
     int color_mode,
     const std::string& dir, 
-    const std::vector<Image>& images
+    const std::vector<Tensor>& images
 ) {
+    TRACE_SCOPE("save images");
+
     int res = CODE_SUCCESS;
 
     int output_number = 0;
     char output_filename[MED_BUF_SIZE];
 
-    for (const auto& output : images) {
+    for (const auto& tensor : images) {
+
+        const Image& output = tensor.view();
 
         snprintf(output_filename, sizeof(output_filename), "%s/out%d.jpeg", 
                 dir.c_str(), output_number++);
 
-        if (color_mode == COLOR_MODE_GRAYSCALE)
-            res = save_float_array_as_grayscale_image(
-                output_filename, 
-                output);
+        res = save_image_as(color_mode, output_filename, output);
+    }
 
-        if (color_mode == COLOR_MODE_RGB)
-            res = save_float_array_as_rgb_image(
-                output_filename, 
-                output);
+    return res;
+}
 
-        if (res != CODE_SUCCESS) {
-            std::string err_msg = "Failed to save image: " + std::string(output_filename);
-            print_err(err_msg.c_str(), res);
-            continue;
+static int allocate_outputs(
+    const std::vector<Tensor>& input_images,
+    const Kernel& kernel,
+    int stride,
+    std::vector<Tensor>& output_images
+) {
+    output_images.clear();
+    output_images.reserve(input_images.size());
+
+    for (const auto& image : input_images) {
+
+        Conv2DParams conv2d_params = {
+            image.view(),
+            kernel, 
+            stride
+        };
+
+        int out_height, out_width;
+        conv2d_output_size(conv2d_params, out_height, out_width);
+
+        if (out_height <= 0 || out_width <= 0) {
+            print_err("Image is smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+            return CODE_FAILURE_INVALID_ARG;
         }
+
+        output_images.emplace_back(out_height, out_width, image.view().channels, image.view().dtype);
     }
 
+    return CODE_SUCCESS;
+}
+
+static double image_bytes(const Image& image) {
+    return (double) image.height * image.width * image.channels * dtype_size(image.dtype);
+}
+
+// One batch call per pass: validation, tap broadcasts and thread start-up
+// are paid once for the directory instead of once per image
+static int convolve_images(
+    int engine_mode,
+    const std::vector<Tensor>& input_images,
+    const Kernel& kernel,
+    int stride,
+    std::vector<Tensor>& output_images,
+    int threads,
+    const PerfCounters *perf,
+    PerfSample *perf_sample,
+    double& elapsed_ms
+) {
+    TRACE_SCOPE("run");
+
+    int res = CODE_SUCCESS;
+
+    std::vector<Image> inputs;
+    std::vector<Image> outputs;
+
+    inputs.reserve(input_images.size());
+    outputs.reserve(output_images.size());
+
+    for (size_t i = 0; i < input_images.size(); i++) {
+        inputs.push_back(input_images[i].view());
+        outputs.push_back(output_images[i].view());
+    }
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> t0, t1;
+
+    // Counters follow the calling thread only; validate_cli() rejects
+    // --perf with more than one worker, so the window covers every image
+    if (perf)
+        perf_counters_start(*perf);
+
+    t0 = std::chrono::high_resolution_clock::now();
+
+    res = conv2d_batch(
+            engine_mode,
+            kernel,
+            stride,
+            inputs.data(),
+            outputs.data(),
+            inputs.size(),
+            threads);
+
+    t1 = std::chrono::high_resolution_clock::now();
+
+    if (perf) {
+        perf_counters_stop(*perf, *perf_sample);
+        for (size_t i = 0; i < inputs.size(); i++)
+            perf_sample->bytes += image_bytes(inputs[i]) + image_bytes(outputs[i]);
+    }
+
+    elapsed_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    return res;
+}
+
+static void fill_report(
+    const SpeedTestParams& speed_test_params,
+    const std::vector<Tensor>& output_images,
+    BenchmarkReport& report
+) {
+    double pixels = 0.0;
+    for (const auto& output : output_images)
+        pixels += (double) output.view().height * output.view().width * output.view().channels;
+
+    int taps = speed_test_params.kernel_size * speed_test_params.kernel_size;
+
+    report.engine_mode = speed_test_params.engine_mode;
+    report.kernel_type = speed_test_params.kernel_type;
+    report.kernel_size = speed_test_params.kernel_size;
+    report.color_mode  = speed_test_params.color_mode;
+    report.dtype       = speed_test_params.dtype;
+    report.threads     = speed_test_params.conv_threads;
+    report.warmup      = speed_test_params.warmup;
+    report.images      = static_cast<int>(output_images.size());
+    report.megapixels  = pixels / 1e6;
+    report.gflop       = pixels * taps * 2.0 / 1e9;
+}
+
+struct PipelineItem {
+    size_t index = 0;
+    Tensor image;
+};
+
+// Records the first failure seen by any pipeline stage
+static void set_pipeline_error(std::atomic<int>& error, int res) {
+    int expected = CODE_SUCCESS;
+    error.compare_exchange_strong(expected, res);
+}
+
+// decoders -> conv workers -> encoders, connected by bounded queues. At most
+// (2 * queue_depth + thread count) images are alive at once, whatever the
+// size of the input directory, and disk I/O, decode and compute overlap.
+static int run_speed_test_pipelined(const SpeedTestParams& speed_test_params) {
+
+    int res = CODE_SUCCESS;
+
+    std::vector<std::string> image_paths;
+
+    KernelRef kernel_ref;
+
+    res = load_image_paths(speed_test_params.input_dir, image_paths);
+    if (res != CODE_SUCCESS) {
+        print_err("Failed to load image paths", res);
+        return res;
+    }
+
+    res = get_kernel_ref(
+        speed_test_params.kernel_type, 
+        speed_test_params.kernel_size, 
+        KERNEL_SIGMA_DEF,
+        kernel_ref);
+    if (res != CODE_SUCCESS) {
+        return res;
+    }
+
+    // Shared, read-only registry entry with pre-broadcast taps
+    const Kernel& kernel = kernel_ref->kernel;
+
+    const int decode_threads = std::max(1, speed_test_params.decode_threads);
+    const int conv_threads   = std::max(1, speed_test_params.conv_threads);
+    const int encode_threads = std::max(1, speed_test_params.encode_threads);
+
+    BoundedQueue<PipelineItem> decoded(speed_test_params.queue_depth);
+    BoundedQueue<PipelineItem> convolved(speed_test_params.queue_depth);
+
+    std::atomic<size_t>    next_path(0);
+    std::atomic<int>       decoders_left(decode_threads);
+    std::atomic<int>       workers_left(conv_threads);
+    std::atomic<int>       error(CODE_SUCCESS);
+    std::atomic<long long> conv_ns(0);
+    std::atomic<int>       images_done(0);
+
+    std::vector<std::thread> threads;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    for (int t = 0; t < decode_threads; t++) {
+        threads.emplace_back([&]() {
+            size_t index;
+            while ((index = next_path++) < image_paths.size() && error == CODE_SUCCESS) {
+                Image image;
+                if (load_image_as(speed_test_params.color_mode, image_paths[index], image) != CODE_SUCCESS)
+                    continue;
+
+                PipelineItem item;
+                item.index = index;
+                item.image = Tensor::adopt(image);
+
+                int convert_res = item.image.convert_to(speed_test_params.dtype);
+                if (convert_res != CODE_SUCCESS) {
+                    set_pipeline_error(error, convert_res);
+                    break;
+                }
+
+                if (!decoded.push(std::move(item)))
+                    break;
+            }
+
+            if (--decoders_left == 0)
+                decoded.close();
+        });
+    }
+
+    for (int t = 0; t < conv_threads; t++) {
+        threads.emplace_back([&]() {
+            PipelineItem item;
+            while (decoded.pop(item)) {
+
+                Conv2DParams conv2d_params = {
+                    item.image.view(),
+                    kernel,
+                    1
+                };
+
+                auto c0 = std::chrono::high_resolution_clock::now();
+
+                Image output;
+                int conv_res = conv2d_channels(
+                        speed_test_params.engine_mode,
+                        conv2d_params,
+                        output);
+
+                auto c1 = std::chrono::high_resolution_clock::now();
+                conv_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(c1 - c0).count();
+
+                if (conv_res != CODE_SUCCESS) {
+                    set_pipeline_error(error, conv_res);
+                    decoded.close();
+                    break;
+                }
+
+                // Input buffer goes back to the pool before the output queues
+                item.image = Tensor::adopt(output);
+
+                if (!convolved.push(std::move(item)))
+                    break;
+            }
+
+            if (--workers_left == 0)
+                convolved.close();
+        });
+    }
+
+    for (int t = 0; t < encode_threads; t++) {
+        threads.emplace_back([&]() {
+            char output_filename[MED_BUF_SIZE];
+
+            PipelineItem item;
+            while (convolved.pop(item)) {
+
+                if (speed_test_params.save_output) {
+                    snprintf(output_filename, sizeof(output_filename), "%s/out%zu.jpeg", 
+                            speed_test_params.output_dir.c_str(), item.index);
+
+                    int save_res = save_image_as(speed_test_params.color_mode, output_filename, item.image.view());
+                    if (save_res != CODE_SUCCESS)
+                        set_pipeline_error(error, save_res);
+                }
+
+                item.image.reset();
+                images_done++;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    double wall_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    res = error.load();
+    if (res != CODE_SUCCESS)
+        return res;
+
+    print_benchmark(speed_test_params.engine_mode, conv_ns.load() / 1e6);
+
+    fprintf(stdout, "Pipeline: %d images in %.3lf ms wall (%.2lf images/s) with %d decoder / %d conv / %d encoder threads\n",
+            images_done.load(), wall_ms, images_done.load() / (wall_ms / 1000.0),
+            decode_threads, conv_threads, encode_threads);
+
     return res;
 }
 
@@ -225,61 +532,90 @@ int run_speed_test(const SpeedTestParams& speed_test_params) {
 
     int res = CODE_SUCCESS;
 
-    std::vector<Image> input_images;
-    std::vector<Image> output_images;
+    if (speed_test_params.pipeline) {
+        return run_speed_test_pipelined(speed_test_params);
+    }
+
+    std::vector<Tensor> input_images;
+    std::vector<Tensor> output_images;
 
+    KernelRef kernel_ref;
     Kernel kernel;
 
     int stride = 1;
 
-    std::chrono::time_point<std::chrono::high_resolution_clock> t0, t1;
-    std::chrono::duration<double, std::milli> elapsed;
+    int repetitions = std::max(1, speed_test_params.repetitions);
+    int warmup      = std::max(0, speed_test_params.warmup);
+
+    std::vector<double> samples;
+
+    BenchmarkReport report;
+
+    double elapsed_ms = 0.0;
+
+    PerfCounters perf;
+    PerfSample   perf_sample;
+    bool         use_perf = false;
 
     res = load_images(
         speed_test_params.color_mode, 
+        speed_test_params.dtype,
         speed_test_params.input_dir, 
+        speed_test_params.decode_threads,
         input_images);
 
     if (res != CODE_SUCCESS) {
         goto _exit;
     }
 
-    res = get_kernel(
+    // Pinned after loading: decoder threads would inherit the mask and all
+    // run on that CPU, and only the convolution is timed
+    if (speed_test_params.cpu >= 0) {
+        pin_to_cpu(speed_test_params.cpu);
+    }
+
+    res = get_kernel_ref(
         speed_test_params.kernel_type, 
         speed_test_params.kernel_size, 
-        kernel);
+        KERNEL_SIGMA_DEF,
+        kernel_ref);
     if (res != CODE_SUCCESS) {
         goto _exit;
     }
 
-    elapsed = std::chrono::duration<double, std::milli>::zero();
-
-    for (auto& image : input_images) {
+    kernel = kernel_ref->kernel;
 
-        Conv2DParams conv2d_params = {
-            image,
-            kernel, 
-            stride
-        };
+    res = allocate_outputs(input_images, kernel, stride, output_images);
+    if (res != CODE_SUCCESS) {
+        goto _exit;
+    }
 
-        t0 = std::chrono::high_resolution_clock::now();
+    if (speed_test_params.perf_counters) {
+        use_perf = perf_counters_open(perf) == CODE_SUCCESS;
+    }
 
-        Image output;
-        res = conv2d_channels(
-                speed_test_params.engine_mode,
-                conv2d_params,
-                output
-        );
+    for (int run = 0; run < warmup + repetitions; run++) {
 
-        t1 = std::chrono::high_resolution_clock::now();
+        // Counters only cover the timed repetitions
+        bool measure = use_perf && run >= warmup;
 
-        elapsed += t1 - t0;
+        res = convolve_images(
+                speed_test_params.engine_mode,
+                input_images,
+                kernel,
+                stride,
+                output_images,
+                speed_test_params.conv_threads,
+                measure ? &perf : nullptr,
+                measure ? &perf_sample : nullptr,
+                elapsed_ms);
 
         if (res != CODE_SUCCESS) {
             goto _exit;
         }
 
-        output_images.push_back(output);
+        if (run >= warmup)
+            samples.push_back(elapsed_ms);
     }
 
     if (speed_test_params.save_output) {
@@ -293,16 +629,25 @@ int run_speed_test(const SpeedTestParams& speed_test_params) {
         }
     }
 
-    print_benchmark(speed_test_params.engine_mode, elapsed.count());
+    fill_report(speed_test_params, output_images, report);
+    compute_benchmark_stats(samples, report.stats);
 
-_exit: 
-    for (auto& image : input_images) 
-        delete[] image.data;
+    // The [TIMING] line is kept for existing scripts; it reports the median.
+    if (speed_test_params.report_format == REPORT_FORMAT_TEXT || !speed_test_params.report_path.empty())
+        print_benchmark(speed_test_params.engine_mode, report.stats.median);
 
-    for (auto& image : output_images)
-        delete[] image.data;
+    if (repetitions > 1 || warmup > 0 || speed_test_params.report_format != REPORT_FORMAT_TEXT) {
+        res = write_benchmark_report(
+                report,
+                speed_test_params.report_format,
+                speed_test_params.report_path);
+    }
+
+    if (use_perf)
+        print_perf_report(speed_test_params.engine_mode, perf_sample);
 
-    delete[] kernel.data;
+_exit: 
+    perf_counters_close(perf);
 
     return res;
-}
\ No newline at end of file
+}
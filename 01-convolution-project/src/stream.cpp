@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstdio>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "stream.h"
+#include "benchmark.h"
+#include "conv2d.h"
+#include "constants.h"
+#include "io.h"
+#include "kernel_factory.h"
+#include "tensor.h"
+#include "utility.h"
+
+#define STREAM_RAW_PATH     "-"
+#define STREAM_DEFAULT_FPS  30.0
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct FrameSource {
+    bool raw = false;
+    cv::VideoCapture capture;
+    cv::Mat frame;          // raw frames are read straight into this
+    double fps = STREAM_DEFAULT_FPS;
+};
+
+struct FrameSink {
+    bool raw     = false;
+    bool enabled = false;
+    cv::VideoWriter writer;
+};
+
+static double ms_between(Clock::time_point t0, Clock::time_point t1) {
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+static int open_source(const StreamParams& params, FrameSource& source) {
+
+    if (params.input == STREAM_RAW_PATH) {
+        if (params.frame_width <= 0 || params.frame_height <= 0) {
+            print_err("Raw stdin frames need --size WxH", CODE_FAILURE_ARG_REQUIRED);
+            return CODE_FAILURE_ARG_REQUIRED;
+        }
+
+        int type = params.color_mode == COLOR_MODE_RGB ? CV_8UC3 : CV_8UC1;
+
+        source.raw = true;
+        source.frame.create(params.frame_height, params.frame_width, type);
+        return CODE_SUCCESS;
+    }
+
+    if (!source.capture.open(params.input)) {
+        print_err("Failed to open video input", CODE_FAILURE_READ_INPUT);
+        return CODE_FAILURE_READ_INPUT;
+    }
+
+    double fps = source.capture.get(cv::CAP_PROP_FPS);
+    if (fps > 0.0)
+        source.fps = fps;
+
+    return CODE_SUCCESS;
+}
+
+// VideoCapture::read reuses source.frame once its geometry is known
+static bool read_frame(FrameSource& source) {
+
+    if (!source.raw)
+        return source.capture.read(source.frame);
+
+    size_t bytes = source.frame.total() * source.frame.elemSize();
+    return fread(source.frame.data, 1, bytes, stdin) == bytes;
+}
+
+static int open_sink(
+    const StreamParams& params,
+    const Image& output,
+    double fps,
+    FrameSink& sink
+) {
+    if (params.output.empty())
+        return CODE_SUCCESS;
+
+    sink.enabled = true;
+
+    if (params.output == STREAM_RAW_PATH) {
+        sink.raw = true;
+        return CODE_SUCCESS;
+    }
+
+    // MJPG in .avi is available in every OpenCV build
+    int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    if (params.output.size() > 4 && params.output.compare(params.output.size() - 4, 4, ".mp4") == 0)
+        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+
+    bool is_color = output.channels == CHANNELS_RGB;
+
+    if (!sink.writer.open(params.output, fourcc, fps, cv::Size(output.width, output.height), is_color)) {
+        print_err("Failed to open video output", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    return CODE_SUCCESS;
+}
+
+static int write_frame(FrameSink& sink, const cv::Mat& frame) {
+
+    if (!sink.enabled)
+        return CODE_SUCCESS;
+
+    if (!sink.raw) {
+        sink.writer.write(frame);
+        return CODE_SUCCESS;
+    }
+
+    size_t bytes = frame.total() * frame.elemSize();
+    if (fwrite(frame.data, 1, bytes, stdout) != bytes) {
+        print_err("Failed to write raw frame", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    return CODE_SUCCESS;
+}
+
+static void print_stream_report(
+    FILE *out,
+    int engine_mode,
+    int frames,
+    double wall_ms,
+    const std::vector<double>& latency_ms,
+    const std::vector<double>& conv_ms
+) {
+    BenchmarkStats latency, conv;
+    if (
+        compute_benchmark_stats(latency_ms, latency) != CODE_SUCCESS ||
+        compute_benchmark_stats(conv_ms, conv) != CODE_SUCCESS
+    ) {
+        fprintf(out, "No frame processed\n");
+        return;
+    }
+
+    fprintf(out, "Engine:     %s\n", get_engine_name(engine_mode).c_str());
+    fprintf(out, "Frames:     %d in %.1lf ms (%.2lf FPS sustained)\n", frames, wall_ms, frames * 1000.0 / wall_ms);
+    fprintf(out, "Latency (ms): median %.3lf | p95 %.3lf | p99 %.3lf | max %.3lf\n",
+            latency.median, latency.p95, latency.p99, latency.max);
+    fprintf(out, "Engine (ms):  median %.3lf | p95 %.3lf | p99 %.3lf | max %.3lf\n",
+            conv.median, conv.p95, conv.p99, conv.max);
+}
+
+int run_stream(const StreamParams& stream_params) {
+
+    int res = CODE_SUCCESS;
+
+    if (stream_params.cpu >= 0)
+        pin_to_cpu(stream_params.cpu);
+
+    // Raw output owns stdout; the report goes to stderr then
+    FILE *report = stream_params.output == STREAM_RAW_PATH ? stderr : stdout;
+
+    int engine_mode = stream_params.engine_mode;
+    int channels    = stream_params.color_mode == COLOR_MODE_RGB ? CHANNELS_RGB : CHANNELS_GRAYSCALE;
+
+    // Decide the fallback once instead of warning on every frame
+    if (!conv2d_engine_supports(engine_mode, stream_params.kernel_size)) {
+        print_warn("Only 3x3 kernels are supported in SSE/AVX engines. Falling back to baseline engine.");
+        engine_mode = ENGINE_MODE_BASELINE;
+    }
+
+    FrameSource source;
+    FrameSink   sink;
+
+    KernelRef kernel_ref;
+    Kernel kernel;
+    Tensor input, output;
+    cv::Mat out_frame;
+
+    std::vector<double> latency_ms, conv_ms;
+    int frames = 0;
+
+    Clock::time_point start;
+
+    res = get_kernel_ref(stream_params.kernel_type, stream_params.kernel_size, KERNEL_SIGMA_DEF, kernel_ref);
+    if (res != CODE_SUCCESS) {
+        print_err("Failed to create kernel", res);
+        return res;
+    }
+
+    kernel = kernel_ref->kernel;
+
+    res = open_source(stream_params, source);
+    if (res != CODE_SUCCESS)
+        goto _exit;
+
+    start = Clock::now();
+
+    while (read_frame(source)) {
+
+        auto t0 = Clock::now();
+
+        // Buffers are sized by the first frame and reused for the rest
+        if (input.empty()) {
+            input = Tensor(source.frame.rows, source.frame.cols, channels);
+
+            Conv2DParams shape_params = { input.view(), kernel, 1 };
+            int out_height, out_width;
+            conv2d_output_size(shape_params, out_height, out_width);
+
+            if (out_height <= 0 || out_width <= 0) {
+                print_err("Frame is smaller than the kernel", CODE_FAILURE_INVALID_ARG);
+                res = CODE_FAILURE_INVALID_ARG;
+                goto _exit;
+            }
+
+            output = Tensor(out_height, out_width, channels);
+
+            res = open_sink(stream_params, output.view(), source.fps, sink);
+            if (res != CODE_SUCCESS)
+                goto _exit;
+        }
+
+        res = frame_to_image(source.frame, input.view());
+        if (res != CODE_SUCCESS)
+            goto _exit;
+
+        Conv2DParams conv2d_params = { input.view(), kernel, 1 };
+
+        auto c0 = Clock::now();
+        res = conv2d_channels_into(engine_mode, conv2d_params, output.view());
+        auto c1 = Clock::now();
+
+        if (res != CODE_SUCCESS)
+            goto _exit;
+
+        res = image_to_frame(output.view(), out_frame);
+        if (res == CODE_SUCCESS)
+            res = write_frame(sink, out_frame);
+        if (res != CODE_SUCCESS)
+            goto _exit;
+
+        auto t1 = Clock::now();
+
+        latency_ms.push_back(ms_between(t0, t1));
+        conv_ms.push_back(ms_between(c0, c1));
+        frames++;
+    }
+
+    print_stream_report(report, engine_mode, frames, ms_between(start, Clock::now()), latency_ms, conv_ms);
+
+_exit:
+    if (sink.raw)
+        fflush(stdout);
+
+    return res;
+}
@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "tensor.h"
+#include "constants.h"
+#include "dtype.h"
+
+// Each block carries a MEMORY_ALIGNMENT sized header in front of the user
+// pointer recording its size class, so tensor_free() needs no size.
+struct BlockHeader {
+    int size_class;
+};
+
+static_assert(sizeof(BlockHeader) <= MEMORY_ALIGNMENT, "header must fit in one alignment unit");
+
+struct BufferPool {
+    std::mutex lock;
+    std::vector<void*> free_blocks[POOL_NUM_SIZE_CLASSES];
+    size_t cached_bytes = 0;
+};
+
+// Leaked like the kernel registry: tensor_free() may run from static
+// destructors after a function-local pool would have been destroyed
+static BufferPool& get_pool() {
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+// Sizes above the largest class get POOL_NUM_SIZE_CLASSES: never cached,
+// and allocated at their exact size rather than rounded up
+static int get_size_class(size_t bytes) {
+    int size_class = 0;
+    size_t class_bytes = (size_t) 1 << POOL_MIN_CLASS_SHIFT;
+
+    while (class_bytes < bytes && size_class < POOL_NUM_SIZE_CLASSES) {
+        class_bytes <<= 1;
+        size_class++;
+    }
+
+    return size_class;
+}
+
+static size_t get_class_bytes(int size_class) {
+    return (size_t) 1 << (POOL_MIN_CLASS_SHIFT + size_class);
+}
+
+bool is_aligned(const void *ptr, size_t alignment) {
+    return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+}
+
+float* tensor_alloc(size_t count) {
+
+    if (count == 0)
+        return nullptr;
+
+    int size_class = get_size_class(count * sizeof(float));
+    void *block = nullptr;
+
+    if (size_class < POOL_NUM_SIZE_CLASSES) {
+        BufferPool& pool = get_pool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+
+        auto& blocks = pool.free_blocks[size_class];
+        if (!blocks.empty()) {
+            block = blocks.back();
+            blocks.pop_back();
+            pool.cached_bytes -= get_class_bytes(size_class);
+        }
+    }
+
+    if (!block) {
+        size_t bytes = size_class < POOL_NUM_SIZE_CLASSES
+            ? get_class_bytes(size_class)
+            : (count * sizeof(float) + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+
+        bytes += MEMORY_ALIGNMENT;
+        block = std::aligned_alloc(MEMORY_ALIGNMENT, bytes);
+        if (!block)
+            throw std::bad_alloc();
+    }
+
+    static_cast<BlockHeader*>(block)->size_class = size_class;
+
+    return reinterpret_cast<float*>(static_cast<char*>(block) + MEMORY_ALIGNMENT);
+}
+
+void tensor_free(const float *data) {
+
+    if (!data)
+        return;
+
+    void *block = const_cast<char*>(reinterpret_cast<const char*>(data)) - MEMORY_ALIGNMENT;
+    int size_class = static_cast<BlockHeader*>(block)->size_class;
+
+    if (size_class < POOL_NUM_SIZE_CLASSES) {
+        BufferPool& pool = get_pool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+
+        auto& blocks = pool.free_blocks[size_class];
+        size_t class_bytes = get_class_bytes(size_class);
+
+        if (
+            blocks.size() < POOL_MAX_CACHED_PER_CLASS &&
+            pool.cached_bytes + class_bytes <= POOL_MAX_CACHED_BYTES
+        ) {
+            blocks.push_back(block);
+            pool.cached_bytes += class_bytes;
+            return;
+        }
+    }
+
+    std::free(block);
+}
+
+void tensor_pool_trim() {
+    BufferPool& pool = get_pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+
+    for (auto& blocks : pool.free_blocks) {
+        for (void *block : blocks)
+            std::free(block);
+        blocks.clear();
+    }
+
+    pool.cached_bytes = 0;
+}
+
+Tensor::Tensor(int height, int width, int channels, int dtype) {
+    image_.height   = height;
+    image_.width    = width;
+    image_.channels = channels;
+    image_.dtype    = dtype;
+    image_.data     = tensor_alloc(dtype_storage_floats(dtype, (size_t) height * width * channels));
+}
+
+Tensor::~Tensor() {
+    reset();
+}
+
+Tensor::Tensor(Tensor&& other) noexcept : image_(other.image_) {
+    other.image_.data = nullptr;
+}
+
+Tensor& Tensor::operator=(Tensor&& other) noexcept {
+    if (this != &other) {
+        reset();
+        image_ = other.image_;
+        other.image_.data = nullptr;
+    }
+
+    return *this;
+}
+
+Tensor Tensor::adopt(const Image& image) {
+    Tensor tensor;
+    tensor.image_ = image;
+    return tensor;
+}
+
+Image Tensor::release() {
+    Image image = image_;
+    image_.data = nullptr;
+    return image;
+}
+
+int Tensor::convert_to(int dtype) {
+    if (image_.dtype == dtype)
+        return CODE_SUCCESS;
+
+    Tensor converted(image_.height, image_.width, image_.channels, dtype);
+
+    int res = image_convert(image_, converted.view());
+    if (res != CODE_SUCCESS)
+        return res;
+
+    *this = std::move(converted);
+    return CODE_SUCCESS;
+}
+
+void Tensor::reset() {
+    tensor_free(image_.data);
+    image_.data = nullptr;
+}
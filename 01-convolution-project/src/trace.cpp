@@ -0,0 +1,157 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+#include "constants.h"
+#include "utility.h"
+
+std::atomic<bool> trace_active { false };
+
+static uint64_t trace_origin_ns = 0;
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+// Written only by its thread; count is published with release so the
+// writer of the JSON sees complete events
+struct TraceRing {
+    int tid = 0;
+    std::atomic<uint64_t> count { 0 };
+    TraceEvent events[TRACE_RING_EVENTS];
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<TraceRing*> rings;
+    std::vector<TraceRing*> free_rings;     // owners exited; handed to new threads
+};
+
+// Leaked on purpose: rings must outlive the threads that wrote them, and
+// trace points may fire during static destruction
+static TraceRegistry& get_trace_registry() {
+    static TraceRegistry *registry = new TraceRegistry();
+    return *registry;
+}
+
+// A ring outlives its thread: on exit it goes back to the free list and the
+// next new thread appends to it under the same tid. Threads started per call
+// (tiled, batch) therefore cost as many rings and tracks as ever ran at once.
+static thread_local TraceRing *ring    = nullptr;
+static thread_local bool       exiting = false;
+
+struct RingReturn {
+    ~RingReturn() {
+        TraceRegistry& registry = get_trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        registry.free_rings.push_back(ring);
+        ring    = nullptr;
+        exiting = true;
+    }
+};
+
+static TraceRing* thread_ring() {
+    if (ring)
+        return ring;
+
+    {
+        TraceRegistry& registry = get_trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if (!registry.free_rings.empty()) {
+            ring = registry.free_rings.back();
+            registry.free_rings.pop_back();
+        }
+        else {
+            ring = new TraceRing();
+            registry.rings.push_back(ring);
+            ring->tid = (int) registry.rings.size();
+        }
+    }
+
+    // Trace points after this thread's thread_local destructors keep the ring
+    if (!exiting) {
+        static thread_local RingReturn ring_return;
+        (void) ring_return;
+    }
+
+    return ring;
+}
+
+void trace_enable(bool enabled) {
+    if (enabled && !trace_origin_ns)
+        trace_origin_ns = trace_now_ns();
+
+    trace_active.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t trace_now_ns() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+    TraceRing *ring = thread_ring();
+
+    uint64_t n = ring->count.load(std::memory_order_relaxed);
+    ring->events[n % TRACE_RING_EVENTS] = { name, start_ns, end_ns };
+    ring->count.store(n + 1, std::memory_order_release);
+}
+
+int trace_write_chrome_json(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        print_err("Failed to open trace file", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    TraceRegistry& registry = get_trace_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    uint64_t dropped = 0;
+
+    for (const TraceRing *ring : registry.rings) {
+        uint64_t n     = ring->count.load(std::memory_order_acquire);
+        uint64_t begin = n > TRACE_RING_EVENTS ? n - TRACE_RING_EVENTS : 0;
+
+        dropped += begin;
+
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", ring->tid, ring->tid);
+        first = false;
+
+        for (uint64_t i = begin; i < n; i++) {
+            const TraceEvent& e = ring->events[i % TRACE_RING_EVENTS];
+
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name, ring->tid,
+                    (double) (e.start_ns - trace_origin_ns) / 1000.0,
+                    (double) (e.end_ns - e.start_ns) / 1000.0);
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+
+    int res = CODE_SUCCESS;
+    if (fclose(out) != 0) {
+        print_err("Failed to write trace file", CODE_FAILURE_WRITE_OUTPUT);
+        res = CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    if (dropped) {
+        char msg[MED_BUF_SIZE];
+        snprintf(msg, sizeof(msg), "Trace rings overflowed; %llu oldest event(s) dropped", (unsigned long long) dropped);
+        print_warn(msg);
+    }
+
+    return res;
+}
@@ -0,0 +1,68 @@
+#include <cstdio>
+
+#include "tune_mode.h"
+#include "autotune.h"
+#include "conv2d.h"
+#include "constants.h"
+#include "io.h"
+#include "kernel_factory.h"
+#include "tensor.h"
+#include "utility.h"
+
+int run_tune(const TuneParams& tune_params) {
+
+    int res = CODE_SUCCESS;
+
+    Image shape;
+    Tensor input;
+    KernelRef kernel;
+    TuneConfig best;
+
+    if (!tune_params.input.empty()) {
+        Image image;
+        res = load_image_as(tune_params.color_mode, tune_params.input, image);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        input = Tensor::adopt(image);
+
+        res = input.convert_to(tune_params.dtype);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        shape = input.view();
+    }
+    else {
+        if (tune_params.frame_width <= 0 || tune_params.frame_height <= 0) {
+            print_err("Tune mode needs --input or --size WxH", CODE_FAILURE_ARG_REQUIRED);
+            return CODE_FAILURE_ARG_REQUIRED;
+        }
+
+        // Geometry only; autotune_shape() benchmarks on its own scratch data
+        shape.data     = nullptr;
+        shape.height   = tune_params.frame_height;
+        shape.width    = tune_params.frame_width;
+        shape.channels = tune_params.color_mode == COLOR_MODE_RGB ? CHANNELS_RGB : CHANNELS_GRAYSCALE;
+        shape.dtype    = tune_params.dtype;
+    }
+
+    res = get_kernel_ref(tune_params.kernel_type, tune_params.kernel_size, KERNEL_SIGMA_DEF, kernel);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    Conv2DParams params = { shape, kernel->kernel, 1 };
+
+    fprintf(stdout, "Tuning %d x %d x %d %s, %s %d x %d\n",
+            shape.width, shape.height, shape.channels, get_dtype_name(shape.dtype).c_str(),
+            get_kernel_type_name(tune_params.kernel_type).c_str(),
+            tune_params.kernel_size, tune_params.kernel_size);
+
+    res = autotune_shape(params, best, stdout);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    fprintf(stdout, "Best: %s, tile %d, %d thread(s), %.4f ms\n",
+            get_engine_name(best.engine_mode).c_str(), best.tile_rows, best.threads, best.ms);
+
+    return autotune_store(tune_key(params), best);
+}
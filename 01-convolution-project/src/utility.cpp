@@ -8,11 +8,47 @@
 #include "utility.h"
 #include "constants.h"
 
-static std::string get_engine_name(int engine_code) {
+std::string get_engine_name(int engine_code) {
     switch (engine_code) {
         case ENGINE_MODE_BASELINE: return ENGINE_MODE_BASELINE_STR;
         case ENGINE_MODE_SSE:      return ENGINE_MODE_SSE_STR;
         case ENGINE_MODE_AVX:      return ENGINE_MODE_AVX_STR;
+        case ENGINE_MODE_AUTO:     return ENGINE_MODE_AUTO_STR;
+
+        default: 
+            return "";
+    }
+}
+
+std::string get_dtype_name(int dtype) {
+    switch (dtype) {
+        case DTYPE_F32:  return DTYPE_F32_STR;
+        case DTYPE_F64:  return DTYPE_F64_STR;
+        case DTYPE_F16:  return DTYPE_F16_STR;
+        case DTYPE_BF16: return DTYPE_BF16_STR;
+
+        default: 
+            return "";
+    }
+}
+
+std::string get_kernel_type_name(int kernel_type) {
+    switch (kernel_type) {
+        case KERNEL_TYPE_SHARPEN:       return KERNEL_TYPE_SHARPEN_STR;
+        case KERNEL_TYPE_BOX_BLUR:      return KERNEL_TYPE_BOX_BLUR_STR;
+        case KERNEL_TYPE_GAUSSIAN_BLUR: return KERNEL_TYPE_GAUSSIAN_BLUR_STR;
+        case KERNEL_TYPE_SOBEL_X:       return KERNEL_TYPE_SOBEL_X_STR;
+        case KERNEL_TYPE_SOBEL_Y:       return KERNEL_TYPE_SOBEL_Y_STR;
+
+        default: 
+            return "";
+    }
+}
+
+std::string get_color_mode_name(int color_mode) {
+    switch (color_mode) {
+        case COLOR_MODE_RGB:       return COLOR_MODE_RGB_STR;
+        case COLOR_MODE_GRAYSCALE: return COLOR_MODE_GRAYSCALE_STR;
 
         default: 
             return "";
@@ -24,12 +60,37 @@ void print_benchmark(int engine_code, double elapsed) {
     fprintf(stdout, "%s Engine: %s took %lf ms\n", LOG_LEVEL_TIMING, engine_name.c_str(), elapsed);
 }
 
+static LogHandler log_handler      = nullptr;
+static void      *log_handler_user = nullptr;
+
+static thread_local char last_error[LRG_BUF_SIZE];
+
+void set_log_handler(LogHandler handler, void *user) {
+    log_handler      = handler;
+    log_handler_user = user;
+}
+
+void stderr_log_handler(int log_kind, const char *msg, int errcode, void *) {
+    if (log_kind == LOG_KIND_ERROR)
+        fprintf(stderr, "%s %s (CODE: %d)\n", LOG_LEVEL_ERROR, msg, errcode);
+    else
+        fprintf(stderr, "%s %s\n", LOG_LEVEL_WARNING, msg);
+}
+
+const char* last_error_message() {
+    return last_error;
+}
+
 void print_err(const char *msg, int errcode) {
-    fprintf(stderr, "%s %s (CODE: %d)\n", LOG_LEVEL_ERROR, msg, errcode);
+    snprintf(last_error, sizeof(last_error), "%s (CODE: %d)", msg, errcode);
+
+    if (log_handler)
+        log_handler(LOG_KIND_ERROR, msg, errcode, log_handler_user);
 }
 
 void print_warn(const char *msg) {
-    fprintf(stderr, "%s %s\n", LOG_LEVEL_WARNING, msg);
+    if (log_handler)
+        log_handler(LOG_KIND_WARNING, msg, 0, log_handler_user);
 }
 
 int safe_atoi(const char *s, int *out)
@@ -0,0 +1,779 @@
+// Differential correctness and performance regression suite for the conv2d
+// engines (make check / make bench).
+//
+//   conv2d_check [--seed N] [--trials N]
+//       Random images, views, kernels and dtypes through every engine and
+//       through the tiled/threaded driver and the batch API, each compared
+//       with a double-precision reference. Exits non-zero on any mismatch.
+//
+//   conv2d_check --bench [--baseline FILE] [--threshold PCT] [--update] [--cpu N]
+//       Times fixed shapes on every engine that takes the kernel and compares
+//       the fastest run with FILE, failing when one is more than PCT percent
+//       slower. A missing FILE (or --update) records the current timings.
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "constants.h"
+#include "conv2d.h"
+#include "dtype.h"
+#include "kernel_factory.h"
+#include "libconv2d.h"
+#include "tensor.h"
+#include "utility.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const int ENGINES[] = { ENGINE_MODE_BASELINE, ENGINE_MODE_SSE, ENGINE_MODE_AVX };
+static const int DTYPES[]  = { DTYPE_F32, DTYPE_F64, DTYPE_F16, DTYPE_BF16 };
+
+// ==========================================================================
+// =============================== Kernels ==================================
+// ==========================================================================
+
+enum KernelShape {
+    SHAPE_RANDOM,
+    SHAPE_SYMMETRIC_H,
+    SHAPE_SYMMETRIC_V,
+    SHAPE_SYMMETRIC_HV,
+    SHAPE_ANTISYMMETRIC_H,
+    SHAPE_ANTISYMMETRIC_V,
+    SHAPE_COUNT
+};
+
+// Owns a hand-built kernel; taps are optional, like on engine callers' kernels
+struct TestKernel {
+    Kernel kernel;
+    KernelRef ref;              // set instead for registry kernels
+    std::vector<float> data;
+    float *taps = nullptr;
+    std::string name;
+
+    TestKernel() = default;
+    TestKernel(const TestKernel&) = delete;
+    TestKernel& operator=(const TestKernel&) = delete;
+    ~TestKernel() { tensor_free(taps); }
+};
+
+static const char* shape_name(int shape) {
+    switch (shape) {
+        case SHAPE_RANDOM:          return "random";
+        case SHAPE_SYMMETRIC_H:     return "sym_h";
+        case SHAPE_SYMMETRIC_V:     return "sym_v";
+        case SHAPE_SYMMETRIC_HV:    return "sym_hv";
+        case SHAPE_ANTISYMMETRIC_H: return "antisym_h";
+        case SHAPE_ANTISYMMETRIC_V: return "antisym_v";
+        default:                    return "?";
+    }
+}
+
+static void make_random_kernel(
+    std::mt19937& rng,
+    int size,
+    int shape,
+    bool with_taps,
+    TestKernel& out
+) {
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    std::vector<float>& k = out.data;
+    k.resize(size * size);
+
+    for (float& tap : k)
+        tap = value(rng);
+
+    const int m = size - 1;
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float& tap = k[y * size + x];
+
+            switch (shape) {
+                case SHAPE_SYMMETRIC_H:
+                    if (x > m - x) tap = k[y * size + (m - x)];
+                    break;
+                case SHAPE_SYMMETRIC_V:
+                    if (y > m - y) tap = k[(m - y) * size + x];
+                    break;
+                case SHAPE_SYMMETRIC_HV:
+                    tap = k[std::min(y, m - y) * size + std::min(x, m - x)];
+                    break;
+                case SHAPE_ANTISYMMETRIC_H:
+                    if (x == m - x) tap = 0.0f;
+                    else if (x > m - x) tap = -k[y * size + (m - x)];
+                    break;
+                case SHAPE_ANTISYMMETRIC_V:
+                    if (y == m - y) tap = 0.0f;
+                    else if (y > m - y) tap = -k[(m - y) * size + x];
+                    break;
+            }
+        }
+    }
+
+    out.kernel.data     = k.data();
+    out.kernel.type     = KERNEL_TYPE_NONE;
+    out.kernel.size     = size;
+    out.kernel.symmetry = find_kernel_symmetry(k.data(), size);
+
+    if (with_taps) {
+        out.taps = tensor_alloc((size_t) size * size * KERNEL_TAP_LANES);
+        for (int i = 0; i < size * size; i++)
+            for (int l = 0; l < KERNEL_TAP_LANES; l++)
+                out.taps[i * KERNEL_TAP_LANES + l] = k[i];
+        out.kernel.taps = out.taps;
+    }
+
+    out.name = std::string(shape_name(shape)) + std::to_string(size) + (with_taps ? "+taps" : "");
+}
+
+static int make_registry_kernel(int kernel_type, int size, TestKernel& out) {
+    int res = get_kernel_ref(kernel_type, size, KERNEL_SIGMA_DEF, out.ref);
+    if (res != CODE_SUCCESS)
+        return res;
+
+    out.kernel = out.ref->kernel;
+    out.name   = get_kernel_type_name(kernel_type) + " " + std::to_string(size);
+    return CODE_SUCCESS;
+}
+
+// ==========================================================================
+// ============================ Differential ================================
+// ==========================================================================
+
+// Fills a packed f32 tensor, then converts it to dtype
+static void fill_random(std::mt19937& rng, Tensor& tensor, int dtype) {
+    std::uniform_real_distribution<float> pixel(0.0f, 1.0f);
+
+    const Image& img = tensor.view();
+    size_t count = (size_t) img.height * img.width * img.channels;
+
+    for (size_t i = 0; i < count; i++)
+        tensor.data()[i] = pixel(rng);
+
+    tensor.convert_to(dtype);
+}
+
+static void fill_value(const Tensor& tensor, float value) {
+    const Image& img = tensor.view();
+    size_t count = (size_t) img.height * img.width * img.channels;
+
+    for (size_t i = 0; i < count; i++) {
+        void *p = image_element(img, i);
+        switch (img.dtype) {
+            case DTYPE_F64:  *static_cast<double*>(p)   = value;                 break;
+            case DTYPE_F16:  *static_cast<uint16_t*>(p) = float_to_half(value);  break;
+            case DTYPE_BF16: *static_cast<uint16_t*>(p) = float_to_bf16(value);  break;
+            default:         *static_cast<float*>(p)    = value;                 break;
+        }
+    }
+}
+
+static double pixel_at(const Image& img, int c, int y, int x) {
+    const void *p = image_element(img, c * image_channel_stride(img) + (size_t) y * image_row_stride(img) + x);
+    switch (img.dtype) {
+        case DTYPE_F64:  return *static_cast<const double*>(p);
+        case DTYPE_F16:  return half_to_float(*static_cast<const uint16_t*>(p));
+        case DTYPE_BF16: return bf16_to_float(*static_cast<const uint16_t*>(p));
+        default:         return *static_cast<const float*>(p);
+    }
+}
+
+struct CheckResult {
+    int    cases     = 0;
+    int    failures  = 0;
+    double max_ratio = 0.0;     // worst error / bound
+};
+
+// Every output must lie within (taps + 2) * eps * sum|k * x| of the exact
+// sum of the stored inputs, eps being the accumulator's epsilon: a bound any
+// summation order meets, including the folded (mirror-add first) engines.
+// Half-precision outputs may be off by one more rounding of the result.
+// Writes outside the output view are failures.
+static bool compare(
+    const char *label,
+    const Conv2DParams& params,
+    const Tensor& out_buffer,
+    int oy,
+    int ox,
+    CheckResult& result
+) {
+    const Kernel& k = params.kernel;
+    const double taps = (double) k.size * k.size;
+
+    const int dtype = params.image.dtype;
+
+    const double acc_eps   = dtype == DTYPE_F64 ? DBL_EPSILON : FLT_EPSILON;
+    const double store_eps =
+        dtype == DTYPE_F16  ? 1.0 / (1 << 11) :
+        dtype == DTYPE_BF16 ? 1.0 / (1 << 8)  : 0.0;
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    const Image& whole = out_buffer.view();
+
+    Tensor canary(1, 1, 1, dtype);
+    fill_value(canary, CHECK_CANARY);
+    const double canary_value = pixel_at(canary.view(), 0, 0, 0);
+
+    for (int c = 0; c < whole.channels; c++) {
+        for (int y = 0; y < whole.height; y++) {
+            for (int x = 0; x < whole.width; x++) {
+
+                int vy = y - oy;
+                int vx = x - ox;
+
+                bool inside =
+                    c < params.image.channels &&
+                    vy >= 0 && vy < out_height &&
+                    vx >= 0 && vx < out_width;
+
+                double got = pixel_at(whole, c, y, x);
+
+                if (!inside) {
+                    if (got != canary_value) {
+                        fprintf(stderr, "%s %s: wrote outside the output view at c=%d y=%d x=%d\n",
+                                LOG_LEVEL_ERROR, label, c, y, x);
+                        return false;
+                    }
+                    continue;
+                }
+
+                double exact = 0.0, magnitude = 0.0;
+                for (int u = 0; u < k.size; u++) {
+                    for (int v = 0; v < k.size; v++) {
+                        double term = (double) k.data[u * k.size + v] * pixel_at(params.image, c, vy + u, vx + v);
+                        exact     += term;
+                        magnitude += std::fabs(term);
+                    }
+                }
+
+                // The narrowing rounds the computed sum, not the exact one;
+                // f16 results below its normal range round to 2^-24 steps
+                double sum_error = (taps + 2.0) * acc_eps * magnitude;
+                double bound =
+                    sum_error + store_eps * (std::fabs(exact) + sum_error) +
+                    (dtype == DTYPE_F16 ? std::ldexp(1.0, -25) : FLT_MIN);
+                double ratio = std::fabs(got - exact) / bound;
+
+                result.max_ratio = std::max(result.max_ratio, ratio);
+
+                if (!(ratio <= 1.0)) {
+                    fprintf(stderr, "%s %s: c=%d y=%d x=%d got %.17g expected %.17g (bound %.3g)\n",
+                            LOG_LEVEL_ERROR, label, c, vy, vx, got, exact, bound);
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static void run_case(
+    std::mt19937& rng,
+    int trial,
+    const TestKernel& tk,
+    CheckResult& result
+) {
+    std::uniform_int_distribution<int> pad(0, 9);
+    std::uniform_int_distribution<int> coin(0, 1);
+
+    const int k = tk.kernel.size;
+
+    int height   = k + std::uniform_int_distribution<int>(0, 40)(rng);
+    int width    = k + std::uniform_int_distribution<int>(0, 130)(rng);
+    int channels = std::uniform_int_distribution<int>(1, 3)(rng);
+    int dtype    = DTYPES[std::uniform_int_distribution<int>(0, 3)(rng)];
+
+    // Half the inputs are unaligned sub-views of a larger buffer
+    Tensor input_buffer;
+    Image input;
+
+    if (coin(rng)) {
+        int py = pad(rng), px = pad(rng);
+        input_buffer = Tensor(height + py + pad(rng), width + px + pad(rng), channels);
+        fill_random(rng, input_buffer, dtype);
+        input = image_roi(input_buffer.view(), py, px, height, width);
+    }
+    else {
+        input_buffer = Tensor(height, width, channels);
+        fill_random(rng, input_buffer, dtype);
+        input = input_buffer.view();
+    }
+
+    Conv2DParams params = { input, tk.kernel, 1 };
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    int oy = pad(rng), ox = pad(rng);
+    Tensor out_buffer(out_height + oy + pad(rng), out_width + ox + pad(rng), channels, dtype);
+    Image out_view = image_roi(out_buffer.view(), oy, ox, out_height, out_width);
+
+    char label[MED_BUF_SIZE];
+
+    for (int e = 0; e <= (int) (sizeof(ENGINES) / sizeof(ENGINES[0])); e++) {
+        const bool tiled = e == (int) (sizeof(ENGINES) / sizeof(ENGINES[0]));
+
+        int engine_mode = tiled
+            ? ENGINES[std::uniform_int_distribution<int>(0, 2)(rng)]
+            : ENGINES[e];
+
+        int tile_rows = std::uniform_int_distribution<int>(0, 5)(rng);
+        int threads   = std::uniform_int_distribution<int>(1, 4)(rng);
+
+        if (tiled)
+            snprintf(label, sizeof(label), "trial %d, %s, %dx%dx%d %s, %s tiled %d/%d",
+                     trial, tk.name.c_str(), width, height, channels, get_dtype_name(dtype).c_str(),
+                     get_engine_name(engine_mode).c_str(), tile_rows, threads);
+        else
+            snprintf(label, sizeof(label), "trial %d, %s, %dx%dx%d %s, %s",
+                     trial, tk.name.c_str(), width, height, channels, get_dtype_name(dtype).c_str(),
+                     get_engine_name(engine_mode).c_str());
+
+        fill_value(out_buffer, CHECK_CANARY);
+
+        int res;
+        if (tiled) {
+            res = conv2d_channels_tiled(engine_mode, params, out_view, tile_rows, threads);
+        }
+        else {
+            Conv2DStatus status;
+            res = conv2d_channels_ws(engine_mode, params, out_view, nullptr, 0, status);
+
+            if (res == CODE_SUCCESS && status.fallback == conv2d_engine_supports(engine_mode, k)) {
+                fprintf(stderr, "%s %s: fallback flag does not match conv2d_engine_supports()\n", LOG_LEVEL_ERROR, label);
+                res = CODE_FAILURE;
+            }
+        }
+
+        result.cases++;
+
+        if (res != CODE_SUCCESS) {
+            fprintf(stderr, "%s %s: returned %d\n", LOG_LEVEL_ERROR, label, res);
+            result.failures++;
+            continue;
+        }
+
+        if (!compare(label, params, out_buffer, oy, ox, result))
+            result.failures++;
+    }
+}
+
+// Images of mixed sizes, now and then one large enough to be split into
+// bands, through conv2d_batch() with a random engine and worker count
+static void run_batch_case(
+    std::mt19937& rng,
+    int trial,
+    const TestKernel& tk,
+    CheckResult& result
+) {
+    std::uniform_int_distribution<int> pad(0, 9);
+
+    const int k = tk.kernel.size;
+
+    int count       = std::uniform_int_distribution<int>(1, 6)(rng);
+    int channels    = std::uniform_int_distribution<int>(1, 3)(rng);
+    int dtype       = DTYPES[std::uniform_int_distribution<int>(0, 3)(rng)];
+    int engine_mode = ENGINES[std::uniform_int_distribution<int>(0, 2)(rng)];
+    int threads     = std::uniform_int_distribution<int>(0, 4)(rng);
+
+    std::vector<Tensor> input_buffers(count);
+    std::vector<Tensor> out_buffers(count);
+    std::vector<Image>  inputs, outputs;
+    std::vector<int>    oys, oxs;
+
+    for (int i = 0; i < count; i++) {
+        bool large = std::uniform_int_distribution<int>(0, 7)(rng) == 0;
+
+        int height = k + std::uniform_int_distribution<int>(0, large ? 300 : 40)(rng);
+        int width  = k + std::uniform_int_distribution<int>(large ? 220 : 0, large ? 300 : 130)(rng);
+
+        input_buffers[i] = Tensor(height, width, channels);
+        fill_random(rng, input_buffers[i], dtype);
+        inputs.push_back(input_buffers[i].view());
+
+        int oy = pad(rng), ox = pad(rng);
+        int out_height = height - k + 1;
+        int out_width  = width - k + 1;
+
+        out_buffers[i] = Tensor(out_height + oy + pad(rng), out_width + ox + pad(rng), channels, dtype);
+        fill_value(out_buffers[i], CHECK_CANARY);
+        outputs.push_back(image_roi(out_buffers[i].view(), oy, ox, out_height, out_width));
+
+        oys.push_back(oy);
+        oxs.push_back(ox);
+    }
+
+    char label[MED_BUF_SIZE];
+    snprintf(label, sizeof(label), "trial %d, %s, batch of %d x%d %s, %s %d threads",
+             trial, tk.name.c_str(), count, channels, get_dtype_name(dtype).c_str(),
+             get_engine_name(engine_mode).c_str(), threads);
+
+    int res = conv2d_batch(engine_mode, tk.kernel, 1, inputs.data(), outputs.data(), count, threads);
+
+    result.cases++;
+
+    if (res != CODE_SUCCESS) {
+        fprintf(stderr, "%s %s: returned %d\n", LOG_LEVEL_ERROR, label, res);
+        result.failures++;
+        return;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        Conv2DParams params = { inputs[i], tk.kernel, 1 };
+        ok = compare(label, params, out_buffers[i], oys[i], oxs[i], result) && ok;
+    }
+
+    if (!ok)
+        result.failures++;
+}
+
+// Output views whose rows or planes overlap, or whose strides are negative,
+// must be rejected before any engine writes through them
+static void run_stride_case(const TestKernel& tk, CheckResult& result) {
+    const int k        = tk.kernel.size;
+    const int height   = k + 8;
+    const int width    = k + 20;
+    const int channels = 2;
+
+    Tensor input(height, width, channels);
+    Tensor out_buffer(2 * height, 2 * width, channels);
+
+    Conv2DParams params = { input.view(), tk.kernel, 1 };
+
+    int out_height, out_width;
+    conv2d_output_size(params, out_height, out_width);
+
+    struct BadStrides { int row_stride; int channel_stride; const char *name; };
+    const BadStrides cases[] = {
+        { -out_width,    0,                                 "negative row stride"     },
+        { out_width - 1, 0,                                 "row stride below width"  },
+        { out_width,     -out_height * out_width,           "negative channel stride" },
+        { out_width,     (out_height - 1) * out_width,      "overlapping channels"    },
+    };
+
+    for (const BadStrides& bad : cases) {
+        Image output = out_buffer.view();
+        output.height         = out_height;
+        output.width          = out_width;
+        output.row_stride     = bad.row_stride;
+        output.channel_stride = bad.channel_stride;
+
+        Conv2DStatus status;
+        int res = conv2d_channels_ws(ENGINE_MODE_BASELINE, params, output, nullptr, 0, status);
+
+        conv2d_image api_input  = { input.view().data, height, width, channels, 0, 0 };
+        conv2d_image api_output = { output.data, out_height, out_width, channels,
+                                    bad.row_stride, bad.channel_stride };
+        conv2d_kernel *api_kernel = nullptr;
+        conv2d_status api_status;
+
+        int api_res = conv2d_kernel_create_from_data(tk.kernel.data, k, &api_kernel);
+        if (api_res == CONV2D_OK) {
+            api_res = conv2d_convolve_ws(CONV2D_ENGINE_BASELINE, &api_input, api_kernel, 1,
+                                         &api_output, nullptr, 0, &api_status);
+            conv2d_kernel_free(api_kernel);
+        }
+
+        result.cases++;
+
+        if (res != CODE_FAILURE_INVALID_ARG || api_res != CONV2D_ERROR_INVALID_ARG) {
+            fprintf(stderr, "%s %s, %s: accepted (core %d, C API %d)\n",
+                    LOG_LEVEL_ERROR, tk.name.c_str(), bad.name, res, api_res);
+            result.failures++;
+        }
+    }
+}
+
+static int run_check(unsigned seed, int trials) {
+    std::mt19937 rng(seed);
+
+    CheckResult result;
+
+    const int registry_types[] = {
+        KERNEL_TYPE_SHARPEN,
+        KERNEL_TYPE_BOX_BLUR,
+        KERNEL_TYPE_GAUSSIAN_BLUR,
+        KERNEL_TYPE_SOBEL_X,
+        KERNEL_TYPE_SOBEL_Y
+    };
+    const int sizes[] = { KERNEL_SIZE_3, KERNEL_SIZE_3, KERNEL_SIZE_5, KERNEL_SIZE_7 };
+
+    for (int trial = 0; trial < trials; trial++) {
+        TestKernel tk;
+
+        int size = sizes[std::uniform_int_distribution<int>(0, 3)(rng)];
+        int pick = std::uniform_int_distribution<int>(0, SHAPE_COUNT)(rng);
+
+        if (pick == SHAPE_COUNT) {
+            int type = registry_types[std::uniform_int_distribution<int>(0, 4)(rng)];
+
+            // Sharpen and Sobel only exist as 3x3
+            if (type != KERNEL_TYPE_BOX_BLUR && type != KERNEL_TYPE_GAUSSIAN_BLUR)
+                size = KERNEL_SIZE_3;
+
+            if (make_registry_kernel(type, size, tk) != CODE_SUCCESS) {
+                result.failures++;
+                continue;
+            }
+        }
+        else {
+            make_random_kernel(rng, size, pick, std::uniform_int_distribution<int>(0, 1)(rng), tk);
+        }
+
+        run_case(rng, trial, tk, result);
+        run_batch_case(rng, trial, tk, result);
+
+        if (trial == 0)
+            run_stride_case(tk, result);
+    }
+
+    fprintf(stdout, "Check:      seed %u, %d trials, %d engine runs\n", seed, trials, result.cases);
+    fprintf(stdout, "Max error:  %.3f of the bound\n", result.max_ratio);
+    fprintf(stdout, "Failures:   %d\n", result.failures);
+
+    return result.failures ? CODE_FAILURE : CODE_SUCCESS;
+}
+
+// ==========================================================================
+// =============================== Bench ====================================
+// ==========================================================================
+
+struct BenchShape {
+    int height, width, channels;
+    int dtype;
+};
+
+struct BenchKernel {
+    int kernel_type;            // KERNEL_TYPE_NONE for a random kernel
+    int kernel_size;
+    const char *name;
+};
+
+static const BenchShape BENCH_SHAPES[] = {
+    {  512,  512, 1, DTYPE_F32  },
+    { 1080, 1920, 1, DTYPE_F32  },
+    {  768, 1024, 3, DTYPE_F32  },
+    { 1080, 1920, 1, DTYPE_F64  },
+    { 1080, 1920, 1, DTYPE_F16  },
+    { 1080, 1920, 1, DTYPE_BF16 },
+};
+
+static const BenchKernel BENCH_KERNELS[] = {
+    { KERNEL_TYPE_GAUSSIAN_BLUR, KERNEL_SIZE_3, "gaussian_blur3" },
+    { KERNEL_TYPE_SOBEL_X,       KERNEL_SIZE_3, "sobel_x3"       },
+    { KERNEL_TYPE_NONE,          KERNEL_SIZE_3, "random3"        },
+    { KERNEL_TYPE_GAUSSIAN_BLUR, KERNEL_SIZE_5, "gaussian_blur5" },
+};
+
+// One "<name> <ms>" line per case; '#' starts a comment
+static std::map<std::string, double> load_baseline(const std::string& path, bool& found) {
+    std::map<std::string, double> baseline;
+
+    std::ifstream file(path);
+    found = (bool) file;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream in(line);
+        std::string name;
+        double ms;
+
+        if (in >> name >> ms)
+            baseline[name] = ms;
+    }
+
+    return baseline;
+}
+
+static int save_baseline(const std::string& path, const std::map<std::string, double>& timings) {
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out) {
+        print_err("Failed to write bench baseline", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    fprintf(out, "# conv2d bench baseline: <shape>/<kernel>/<engine> <min ms>\n");
+    for (const auto& entry : timings)
+        fprintf(out, "%s %.6f\n", entry.first.c_str(), entry.second);
+
+    if (fclose(out) != 0) {
+        print_err("Failed to write bench baseline", CODE_FAILURE_WRITE_OUTPUT);
+        return CODE_FAILURE_WRITE_OUTPUT;
+    }
+
+    return CODE_SUCCESS;
+}
+
+// The minimum of the runs: interference only ever adds time, so it is the
+// steadiest figure to compare across runs
+static int time_engine(int engine_mode, const Conv2DParams& params, const Image& output, double& best_ms) {
+    std::vector<double> samples;
+
+    for (int run = 0; run < BENCH_WARMUP + BENCH_REPS; run++) {
+        Conv2DStatus status;
+
+        auto t0 = Clock::now();
+        int res = conv2d_channels_ws(engine_mode, params, output, nullptr, 0, status);
+        auto t1 = Clock::now();
+
+        if (res != CODE_SUCCESS) {
+            print_err(status.message, res);
+            return res;
+        }
+
+        if (run >= BENCH_WARMUP)
+            samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+
+    BenchmarkStats stats;
+    int res = compute_benchmark_stats(samples, stats);
+    best_ms = stats.min;
+
+    return res;
+}
+
+static int run_bench(const std::string& baseline_path, double threshold, bool update) {
+    int res = CODE_SUCCESS;
+
+    bool found;
+    std::map<std::string, double> baseline = load_baseline(baseline_path, found);
+    std::map<std::string, double> timings;
+
+    std::mt19937 rng(BENCH_SEED);
+    int regressions = 0;
+
+    fprintf(stdout, "%-40s %12s %12s %9s\n", "Case", "Baseline ms", "Current ms", "Change");
+
+    for (const BenchShape& shape : BENCH_SHAPES) {
+        Tensor input(shape.height, shape.width, shape.channels);
+        fill_random(rng, input, shape.dtype);
+
+        for (const BenchKernel& bk : BENCH_KERNELS) {
+            TestKernel tk;
+
+            if (bk.kernel_type == KERNEL_TYPE_NONE)
+                make_random_kernel(rng, bk.kernel_size, SHAPE_RANDOM, true, tk);
+            else if ((res = make_registry_kernel(bk.kernel_type, bk.kernel_size, tk)) != CODE_SUCCESS)
+                return res;
+
+            Conv2DParams params = { input.view(), tk.kernel, 1 };
+
+            int out_height, out_width;
+            conv2d_output_size(params, out_height, out_width);
+            Tensor output(out_height, out_width, shape.channels, shape.dtype);
+
+            for (int engine_mode : ENGINES) {
+                // A fallback would only time the baseline again
+                if (!conv2d_engine_supports(engine_mode, bk.kernel_size))
+                    continue;
+
+                std::string name =
+                    std::to_string(shape.width) + "x" + std::to_string(shape.height) + "x" +
+                    std::to_string(shape.channels) +
+                    (shape.dtype != DTYPE_F32 ? "_" + get_dtype_name(shape.dtype) : "") +
+                    "/" + bk.name + "/" + get_engine_name(engine_mode);
+
+                double ms;
+                res = time_engine(engine_mode, params, output.view(), ms);
+                if (res != CODE_SUCCESS)
+                    return res;
+
+                timings[name] = ms;
+
+                auto it = baseline.find(name);
+                if (update || it == baseline.end()) {
+                    fprintf(stdout, "%-40s %12s %12.4f %9s\n", name.c_str(), "-", ms, "new");
+                    continue;
+                }
+
+                double change = (ms / it->second - 1.0) * 100.0;
+                bool regressed = change > threshold;
+
+                fprintf(stdout, "%-40s %12.4f %12.4f %+8.1f%%%s\n",
+                        name.c_str(), it->second, ms, change, regressed ? "  REGRESSION" : "");
+
+                if (regressed)
+                    regressions++;
+            }
+        }
+    }
+
+    if (update || !found) {
+        res = save_baseline(baseline_path, timings);
+        if (res != CODE_SUCCESS)
+            return res;
+
+        fprintf(stdout, "Recorded baseline in %s\n", baseline_path.c_str());
+        return CODE_SUCCESS;
+    }
+
+    fprintf(stdout, "Regressions over %.1f%%: %d\n", threshold, regressions);
+
+    return regressions ? CODE_FAILURE : CODE_SUCCESS;
+}
+
+// ==========================================================================
+// ================================ Main ====================================
+// ==========================================================================
+
+static void usage() {
+    fprintf(stderr,
+        "Usage: conv2d_check [--seed N] [--trials N]\n"
+        "       conv2d_check --bench [--baseline FILE] [--threshold PCT] [--update] [--cpu N]\n");
+}
+
+int main(int argc, char **argv) {
+
+    bool bench  = false;
+    bool update = false;
+    int  cpu    = -1;
+    int  trials = CHECK_TRIALS;
+
+    unsigned seed    = CHECK_SEED;
+    double threshold = BENCH_THRESHOLD_DEF;
+    std::string baseline_path = BENCH_BASELINE_PATH_DEF;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--bench")                        bench = true;
+        else if (arg == "--update")                  update = true;
+        else if (arg == "--seed" && has_value)       seed = (unsigned) strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--trials" && has_value)     trials = atoi(argv[++i]);
+        else if (arg == "--baseline" && has_value)   baseline_path = argv[++i];
+        else if (arg == "--threshold" && has_value)  threshold = atof(argv[++i]);
+        else if (arg == "--cpu" && has_value)        cpu = atoi(argv[++i]);
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cpu >= 0)
+        pin_to_cpu(cpu);
+
+    int res = bench
+        ? run_bench(baseline_path, threshold, update)
+        : run_check(seed, trials);
+
+    return res == CODE_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}